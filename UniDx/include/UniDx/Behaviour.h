@@ -6,27 +6,80 @@
 
 #include "Component.h"
 #include "Transform.h"
+#include "Coroutine.h"
 
 namespace UniDx {
 
 class Collider;
 struct Collision;
 
-/// @brief GameObjectの挙動を記述する基底コンポーネント。UnityのMonoBehaviour相当
+// プレイヤーループで呼び出すメソッド
+enum BehaviourLoop : uint8_t
+{
+    BehaviourLoop_FixedUpdate = 1 << 0,
+    BehaviourLoop_Update = 1 << 1,
+    BehaviourLoop_LateUpdate = 1 << 2,
+    BehaviourLoop_All = BehaviourLoop_FixedUpdate | BehaviourLoop_Update | BehaviourLoop_LateUpdate,
+    BehaviourLoop_ParallelUpdate = 1 << 3, // setParallelUpdate(true) としたときだけ
+};
+
+// 物理のコールバック
+enum PhysicsCallback : uint8_t
+{
+    PhysicsCallback_TriggerEnter = 1 << 0,
+    PhysicsCallback_TriggerStay = 1 << 1,
+    PhysicsCallback_TriggerExit = 1 << 2,
+    PhysicsCallback_CollisionEnter = 1 << 3,
+    PhysicsCallback_CollisionStay = 1 << 4,
+    PhysicsCallback_CollisionExit = 1 << 5,
+    PhysicsCallback_All = 0x3f,
+};
+
+/**
+ * @brief GameObjectの挙動を記述する基底コンポーネント。UnityのMonoBehaviour相当
+ * 有効な間はプレイヤーループの実行リストに登録される。
+ * FixedUpdate(), Update(), LateUpdate() は、オーバーライドされていないと分かった時点で
+ * 実行リストから外すので、派生クラスからこのクラスのものを呼び出さないこと。
+ * OnTriggerEnter() などの物理のコールバックも同様で、どれもオーバーライドしていなければ
+ * GameObjectの通知先から外れる。
+ * StartCoroutine() で開始したコルーチンは、無効になるか破棄されると停止する
+ */
 class Behaviour : public Component
 {
 public:
-    virtual void FixedUpdate() {}
-    virtual void Update() {}
-    virtual void LateUpdate() {}
-    virtual void OnTriggerEnter(Collider* other) {}
-    virtual void OnTriggerStay(Collider* other) {}
-    virtual void OnTriggerExit(Collider* other) {}
-    virtual void OnCollisionEnter(const Collision& collision) {}
-    virtual void OnCollisionStay(const Collision& collision) {}
-    virtual void OnCollisionExit(const Collision& collision) {}
-
-    virtual ~Behaviour() = default;
+    virtual void FixedUpdate();
+    virtual void Update();
+    virtual void LateUpdate();
+
+    /**
+     * @brief ワーカースレッドで並列に呼ばれる更新処理
+     * setParallelUpdate(true) としたときだけ、全ての Update() のあと LateUpdate() の前に呼ばれる。
+     * 変更してよいのは自身のGameObjectのTransformとメンバだけ。
+     * Destroy(), Transform::SetParent(), enabled の変更は CommandBuffer に記録され、
+     * 全ての ParallelUpdate() が終わってから実行される
+     */
+    virtual void ParallelUpdate() {}
+    virtual void OnTriggerEnter(Collider* other);
+    virtual void OnTriggerStay(Collider* other);
+    virtual void OnTriggerExit(Collider* other);
+    virtual void OnCollisionEnter(const Collision& collision);
+    virtual void OnCollisionStay(const Collision& collision);
+    virtual void OnCollisionExit(const Collision& collision);
+
+    Behaviour() = default;
+    virtual ~Behaviour();
+
+    /**
+     * @brief コルーチンを開始する。最初の待機まではこの中で実行される
+     * 無効なときや、並列更新中には開始できない
+     */
+    CoroutineHandle StartCoroutine(Coroutine routine);
+
+    /// @brief StartCoroutine() で開始したコルーチンを停止する
+    void StopCoroutine(CoroutineHandle handle);
+
+    /// @brief このBehaviourで開始した全てのコルーチンを停止する
+    void StopAllCoroutines();
 
     template<typename T>
     T* GetComponent(bool includeInactive = false) const { return gameObject->GetComponent<T>(includeInactive); }
@@ -38,6 +91,38 @@ public:
         if (c != nullptr || transform->parent == nullptr) return c;
         return transform->parent->gameObject->GetComponent<T>(includeInactive);
     }
+
+protected:
+    // 複製用。オーバーライドの情報だけを写し、実行リスト内の位置は初期化する
+    Behaviour(const Behaviour& source) :
+        Component(source), loopFlags_(source.loopFlags_), physicsCallbacks_(source.physicsCallbacks_) {}
+
+    virtual void registerLoop() override;
+    virtual void unregisterLoop() override;
+
+    /// @brief ParallelUpdate() を呼び出すかを設定（コンストラクタで設定する）
+    void setParallelUpdate(bool value);
+
+private:
+    uint8_t loopFlags_ = BehaviourLoop_All; // オーバーライドされている可能性のあるメソッド
+    uint8_t physicsCallbacks_ = PhysicsCallback_All; // オーバーライドされている可能性のある物理のコールバック
+
+    // 実行リスト内の位置
+    uint32_t fixedUpdateSlot_ = UINT32_MAX;
+    uint32_t updateSlot_ = UINT32_MAX;
+    uint32_t lateUpdateSlot_ = UINT32_MAX;
+    uint32_t parallelUpdateSlot_ = UINT32_MAX;
+    uint32_t startSlot_ = UINT32_MAX;
+
+    // 実行中のコルーチンのリストの先頭（CoroutineScheduler 内の位置）
+    uint32_t coroutineSlot_ = UINT32_MAX;
+
+    // オーバーライドされていない物理のコールバックを外す
+    void removePhysicsCallback(PhysicsCallback callback);
+
+    friend class PlayerLoop;
+    friend class GameObject;
+    friend class CoroutineScheduler;
 };
 
 
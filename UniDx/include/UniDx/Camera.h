@@ -1,10 +1,12 @@
-#pragma once
+﻿#pragma once
 
 #include "Behaviour.h"
 
 
 namespace UniDx {
 
+class FramePacket;
+
 // --------------------
 // Cameraクラス
 // --------------------
@@ -21,8 +23,8 @@ public:
 
     Matrix4x4 GetProjectionMatrix(float aspect) const;
 
-    // 定数バッファ更新
-    void UpdateConstantBuffer();
+    // カメラと時間の定数をパケットに写す
+    void extract(FramePacket& packet) const;
 
 protected:
     virtual void OnEnable() override;
@@ -6,6 +6,7 @@ namespace UniDx {
 
 class UIBehaviour;
 class Material;
+class FramePacket;
 
 // --------------------
 // Canvasクラス
@@ -16,7 +17,7 @@ public:
 	virtual void Awake() override;
 	virtual void OnEnable() override;
 	virtual void OnDisable() override;
-	virtual void render() const;
+	virtual void extract(FramePacket& packet) const;
 
 	void LoadDefaultMaterial(const char8_t* assetPath);
 
@@ -25,13 +26,13 @@ public:
 
 	Vector2 size;
 
-	Material* getDefaultMaterial();
-	Material* getDefaultTextureMaterial();
+	const std::shared_ptr<Material>& getDefaultMaterial() const { return defaultMaterial; }
+	const std::shared_ptr<Material>& getDefaultTextureMaterial() const { return defaultTextureMaterial; }
 
 private:
 	std::vector<UIBehaviour*> elements_;
-	std::unique_ptr<Material> defaultMaterial;			// 頂点はVertexPC
-	std::unique_ptr<Material> defaultTextureMaterial;	// 頂点はVertexPTC
+	std::shared_ptr<Material> defaultMaterial;			// 頂点はVertexPC
+	std::shared_ptr<Material> defaultTextureMaterial;	// 頂点はVertexPTC
 };
 
 }
@@ -26,17 +26,38 @@ namespace UniDx
         virtual void OnEnable() override
         {
             attachedRigidbody = findNearestRigidbody(transform);
-            Physics::getInstance()->register3d(this);
+            registeredWorld_ = getPhysicsWorld();
+            registeredWorld_->register3d(this);
         }
 
         virtual void OnDisable() override
         {
-            Physics::getInstance()->unregister3d(this);
+            // 登録したときのワールドから外す（Rigidbody が先に破棄されていても参照しない）
+            if (registeredWorld_ != nullptr) registeredWorld_->unregister3d(this);
+            registeredWorld_ = nullptr;
         }
 
+        // 登録先の物理ワールドを取得
+        // 未指定なら attachedRigidbody のワールド、Rigidbody もなければデフォルトの Physics
+        PhysicsWorld* getPhysicsWorld() const;
+
+        // 登録先の物理ワールドを変更。attachedRigidbody と同じワールドにすること
+        void setPhysicsWorld(PhysicsWorld* world)
+        {
+            physicsWorld_ = world;
+            updatePhysicsWorld();
+        }
+
+        // 登録先が getPhysicsWorld() と異なっていれば登録し直す
+        // Rigidbody::setPhysicsWorld() からも呼ばれる
+        void updatePhysicsWorld();
+
         // ワールド空間における空間境界を取得
         virtual Bounds getBounds() const = 0;
 
+        // スナップショット用のワールド空間の形状データを取得
+        virtual void getShapeData(PhysicsShapeData& data) const = 0;
+
         // レイキャストチェック
         // 始点が内部のときは false を返す
         virtual bool Raycast(Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo = nullptr) = 0;
@@ -48,11 +69,31 @@ namespace UniDx
 
         // 衝突チェック
         // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-        virtual bool checkIntersect(Collider* other, PhysicsActor* myActor, PhysicsActor* otherActor) = 0;
-        virtual bool checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor) = 0;
-        virtual bool checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor) = 0;
+        // collision には自分から見た衝突情報（相手のコライダーと接触点）を入れる
+        virtual bool checkIntersect(Collider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision) = 0;
+        virtual bool checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision) = 0;
+        virtual bool checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision) = 0;
+
+    protected:
+        Collider() = default;
+
+        // 複製用。設定だけを写し、接続先のRigidbodyと境界のキャッシュは有効化したときに求め直す
+        Collider(const Collider& source) :
+            Component(source),
+            isTrigger(source.isTrigger),
+            bounciness(source.bounciness),
+            physicsWorld_(source.physicsWorld_)
+        {
+        }
+
+        // getBounds() の結果と、そのときのTransformの世代番号
+        mutable Bounds cachedBounds_;
+        mutable uint32_t cachedBoundsVersion_ = 0;
 
     private:
+        PhysicsWorld* physicsWorld_ = nullptr;      // 指定された登録先
+        PhysicsWorld* registeredWorld_ = nullptr;   // 実際に登録しているワールド
+
         Rigidbody* findNearestRigidbody(Transform* t) const;
     };
 
@@ -68,9 +109,15 @@ namespace UniDx
 
         AABBCollider(Vector3 c = Vector3::zero) : center(c), size(Vector3(0.5f, 0.5f, 0.5f)) {}
 
+        // ワールド空間の境界に対するレイキャスト（hitInfo->collider は設定しない）
+        static bool RaycastBounds(const Bounds& bounds, Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo);
+
         // ワールド空間における空間境界を取得
         virtual Bounds getBounds() const override;
 
+        // スナップショット用のワールド空間の形状データを取得
+        virtual void getShapeData(PhysicsShapeData& data) const override;
+
         // レイキャストチェック
         // 始点が内部のときは false を返す
         virtual bool Raycast(Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo = nullptr);
@@ -82,9 +129,22 @@ namespace UniDx
 
         // 衝突チェック
         // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-        virtual bool checkIntersect(Collider* other, PhysicsActor* myActor, PhysicsActor* otherActor) { return other->checkIntersect(this, otherActor, myActor); }
-        virtual bool checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor);
-        virtual bool checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor);
+        virtual bool checkIntersect(Collider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision)
+        {
+            if (!other->checkIntersect(this, otherActor, myActor, collision)) return false;
+            *collision = collision->reversed(other); // 相手から見た情報なので反転
+            return true;
+        }
+        virtual bool checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision);
+        virtual bool checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision);
+
+    protected:
+        virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
+
+    private:
+        // cachedBounds_ を計算したときの形状
+        mutable Vector3 cachedCenter_;
+        mutable Vector3 cachedSize_;
     };
 
 
@@ -99,9 +159,15 @@ namespace UniDx
 
         SphereCollider(Vector3 c = Vector3::zero, float r = 0.5) : center(c), radius(r) {}
 
+        // ワールド空間の球に対するレイキャスト（hitInfo->collider は設定しない）
+        static bool RaycastSphere(Vector3 centerWorld, float radius, Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo);
+
         // ワールド空間における空間境界を取得
         virtual Bounds getBounds() const override;
 
+        // スナップショット用のワールド空間の形状データを取得
+        virtual void getShapeData(PhysicsShapeData& data) const override;
+
         // レイキャストチェック
         // 始点が内部のときは false を返す
         virtual bool Raycast(Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo = nullptr);
@@ -113,9 +179,22 @@ namespace UniDx
 
         // 衝突チェック
         // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-        virtual bool checkIntersect(Collider* other, PhysicsActor* myActor, PhysicsActor* otherActor) { return other->checkIntersect(this, otherActor, myActor); }
-        virtual bool checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor);
-        virtual bool checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor);
+        virtual bool checkIntersect(Collider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision)
+        {
+            if (!other->checkIntersect(this, otherActor, myActor, collision)) return false;
+            *collision = collision->reversed(other); // 相手から見た情報なので反転
+            return true;
+        }
+        virtual bool checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision);
+        virtual bool checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision);
+
+    protected:
+        virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
+
+    private:
+        // cachedBounds_ を計算したときの形状
+        mutable Vector3 cachedCenter_;
+        mutable float cachedRadius_ = 0.0f;
     };
 
 
@@ -1,5 +1,8 @@
 ﻿#pragma once
 
+#include <array>
+#include <span>
+
 #include "UniDxDefine.h"
 
 
@@ -26,8 +29,39 @@ struct ContactPoint
 struct Collision
 {
 public:
-    Collider* collider;                 // 衝突した相手側のコライダー
-    std::vector<ContactPoint> contacts;
+    static constexpr int ContactCountMax = 4;
+
+    Collider* collider = nullptr;       // 衝突した相手側のコライダー
+    std::array<ContactPoint, ContactCountMax> contacts; // 接触点。normal は相手側からこちら側への向き
+    int contactCount = 0;               // contacts の有効な数
+
+    /// @brief 接触点を取得
+    const ContactPoint& GetContact(int index) const { return contacts[index]; }
+
+    /// @brief 有効な接触点の範囲を取得
+    std::span<const ContactPoint> GetContacts() const { return { contacts.data(), size_t(contactCount) }; }
+
+    /// @brief 接触点を追加（最大数を超えたものは無視）
+    void addContact(Vector3 point, Vector3 normal)
+    {
+        if (contactCount < ContactCountMax)
+        {
+            contacts[contactCount++] = ContactPoint{ point, normal };
+        }
+    }
+
+    /// @brief 相手側から見た衝突情報を作成。self は相手から見た衝突相手（＝こちら側のコライダー）
+    Collision reversed(Collider* self) const
+    {
+        Collision r;
+        r.collider = self;
+        r.contactCount = contactCount;
+        for (int i = 0; i < contactCount; ++i)
+        {
+            r.contacts[i] = ContactPoint{ contacts[i].point, -contacts[i].normal };
+        }
+        return r;
+    }
 };
 
 
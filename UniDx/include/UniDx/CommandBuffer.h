@@ -0,0 +1,58 @@
+﻿/**
+ * @file CommandBuffer.h
+ * @brief 並列更新中に発行された構造の変更を記録し、同期点でまとめて実行する
+ */
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+
+#include "UniDxDefine.h"
+
+namespace UniDx
+{
+
+/**
+ * @brief 並列更新中に発行された構造の変更を記録するバッファ
+ * 並列更新の間はスレッドごとに１つ用意され、Destroy(), Transform::SetParent(), enabled の変更などは
+ * 実行されずに current() のバッファに記録される。
+ * 並列更新が終わると endRecording() でスレッドの番号順、各スレッド内では記録順に実行される。
+ */
+class CommandBuffer
+{
+public:
+    using Command = std::function<void()>;
+
+    /// @brief 現在のスレッドで記録中のバッファ。並列更新中でなければ nullptr
+    static CommandBuffer* current();
+
+    /// @brief 並列更新を始める。threadCount はバッファを使うスレッドの数
+    static void beginRecording(size_t threadCount);
+
+    /// @brief 並列更新を終え、記録されたコマンドを実行する（メインスレッドから呼ぶ）
+    static void endRecording();
+
+    /// @brief コマンドを記録
+    void add(Command command) { commands_.push_back(std::move(command)); }
+
+    /// @brief GameObjectへのコンポーネントの追加を記録
+    /// 引数はコピーして保持する
+    template<typename T, typename TGameObject, typename... Args>
+    void addComponent(TGameObject* gameObject, Args... args)
+    {
+        add([gameObject, args...]() { gameObject->template AddComponent<T>(args...); });
+    }
+
+private:
+    std::vector<Command> commands_;
+
+    static std::vector<CommandBuffer> buffers_;
+    static std::atomic<bool> recording_;
+
+    // 記録順に実行して空にする
+    void execute();
+};
+
+} // namespace UniDx
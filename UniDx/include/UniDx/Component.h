@@ -7,12 +7,14 @@
 
 #include "Object.h"
 #include "Property.h"
+#include "ComponentPool.h"
 
 namespace UniDx {
 
 // 前方宣言
 class Behaviour;
 class GameObject;
+class CloneMap;
 
 /** 
   * @brief コンポーネントを破棄
@@ -25,8 +27,8 @@ void Destroy(Component* component);
 class Component : public Object
 {
 public:
-    Property<bool> enabled;
-    ReadOnlyProperty<Transform*> transform;
+    UNIDX_PROPERTY(Component, bool, enabled, getEnabled, setEnabled);
+    UNIDX_READONLY_PROPERTY(Component, Transform*, transform, getTransform);
 
     GameObject* gameObject = nullptr;
 
@@ -39,6 +41,7 @@ public:
             isCalledAwake = true;
 
             OnEnable();
+            if (_enabled) registerLoop();
         }
     }
 
@@ -63,17 +66,53 @@ protected:
     virtual void OnDisable() {}
     virtual void OnDestroy() {}
 
+    // 有効になったときにプレイヤーループの実行リストへ登録し、無効になったときに外す
+    virtual void registerLoop() {}
+    virtual void unregisterLoop() {}
+
     bool isCalledAwake;
     bool isCalledStart;
     bool isCalledDestroy;
     bool _enabled;
+    ComponentPoolBase* pool_ = nullptr; // 確保したプール。new で作ったときは nullptr
+    const Component* prefabSource_ = nullptr; // Prefab で複製したときの複製元
 
     Component();
+
+    // 複製用のコピーコンストラクタ。設定だけを写し、Awake() などの状態は初期化する
+    Component(const Component& source);
+
+    /**
+     * @brief Prefab から複製するときに呼ばれ、同じ設定の新しいコンポーネントを返す
+     * 複製できるコンポーネントは CloneComponent(*this) などを返すようにオーバーライドする
+     */
+    virtual ComponentPtr<Component> clone(CloneMap& map) const { return nullptr; }
+
+    /// @brief 階層全体を複製した後に呼ばれる。複製元を指しているポインタを map で複製先に置き換える
+    virtual void resolveClone(const CloneMap& map) {}
+
     void doDestroy();
 
+    // プロパティのアクセサ
+    bool getEnabled() const { return _enabled && isCalledAwake; }
+    void setEnabled(const bool& value);
+    Transform* getTransform() const; // Transform.h で定義
+    virtual StringId getName() const override;
+
     friend void Destroy(Component*);
     friend class GameObject;
+    friend class Prefab;
+    friend struct ComponentDeleter;
+    template<typename T, size_t ChunkSize> friend class ComponentPool;
 };
 
 
+/// @brief コピーコンストラクタで複製する。Component::clone() の実装に使う
+template<typename T>
+ComponentPtr<Component> CloneComponent(const T& source)
+{
+    return MakeComponent<T>(source);
+}
+
+
 } // namespace UniDx
@@ -0,0 +1,205 @@
+﻿/**
+ * @file ComponentPool.h
+ * @brief コンポーネントを型ごとに連続したメモリに確保するプール
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include "UniDxDefine.h"
+
+namespace UniDx
+{
+
+class Component;
+
+/**
+ * @brief コンポーネントの削除子
+ * プールから確保したものはプールに返し、それ以外は delete する。
+ * std::make_unique で作ったコンポーネントもそのまま受け取れる
+ */
+struct ComponentDeleter
+{
+    ComponentDeleter() noexcept = default;
+
+    template<typename T>
+    ComponentDeleter(const std::default_delete<T>&) noexcept {}
+
+    void operator()(Component* component) const;
+};
+
+/// @brief コンポーネントを所有するポインタ
+template<typename T = Component>
+using ComponentPtr = std::unique_ptr<T, ComponentDeleter>;
+
+
+/// @brief 型によらずプールに返すためのインターフェース
+class ComponentPoolBase
+{
+public:
+    virtual ~ComponentPoolBase() = default;
+
+    // 破棄してプールに返す
+    virtual void destroy(Component* component) = 0;
+};
+
+
+/**
+ * @brief 共通の基底クラスを持つコンポーネント型のプールの一覧
+ * 基底クラスで using PoolGroup = 基底クラス; と宣言すると、派生型のプールは作成時にここへ登録される。
+ * 型ごとのプールを順にメモリの順に走査するので、基底クラスで扱う処理もメモリを先頭から読める
+ */
+template<typename Base>
+class ComponentPoolGroup
+{
+public:
+    using Visitor = void (*)(void* context, Base* component);
+    using PoolForEach = void (*)(void* pool, Visitor visitor, void* context);
+
+    /// @brief この基底クラスの一覧を取得（解放しない）
+    static ComponentPoolGroup& instance()
+    {
+        static ComponentPoolGroup* group = new ComponentPoolGroup();
+        return *group;
+    }
+
+    /// @brief 登録された全てのプールの生きているコンポーネントを、プールごとにメモリの順に呼び出す
+    template<typename Func>
+    void forEach(Func&& func)
+    {
+        using F = std::remove_reference_t<Func>;
+        void* context = const_cast<void*>(static_cast<const void*>(std::addressof(func)));
+        for (const Entry& e : pools_)
+        {
+            e.forEach(e.pool, [](void* c, Base* component) { (*static_cast<F*>(c))(component); }, context);
+        }
+    }
+
+    // ComponentPool から呼ばれる
+    void add(void* pool, PoolForEach forEach) { pools_.push_back({ pool, forEach }); }
+
+private:
+    struct Entry
+    {
+        void* pool;
+        PoolForEach forEach;
+    };
+    std::vector<Entry> pools_;
+};
+
+
+/**
+ * @brief １つのコンポーネント型のプール
+ * ChunkSize 個ずつまとめて確保したチャンクに並べ、空きはフリーリストで管理する。
+ * チャンクは移動しないので、確保したコンポーネントのアドレスは変わらない。
+ * T が PoolGroup を宣言していれば、その ComponentPoolGroup に登録される。
+ * メインスレッドからのみ使うこと
+ */
+template<typename T, size_t ChunkSize = 64>
+class ComponentPool : public ComponentPoolBase
+{
+public:
+    ComponentPool()
+    {
+        if constexpr (requires { typename T::PoolGroup; })
+        {
+            using Group = ComponentPoolGroup<typename T::PoolGroup>;
+            Group::instance().add(this,
+                [](void* pool, typename Group::Visitor visitor, void* context)
+                {
+                    static_cast<ComponentPool*>(pool)->forEach([visitor, context](T* c) { visitor(context, c); });
+                });
+        }
+    }
+
+    /// @brief この型のプールを取得
+    /// 終了時の破棄順に依存しないよう、プール自体は解放しない
+    static ComponentPool& instance()
+    {
+        static ComponentPool* pool = new ComponentPool();
+        return *pool;
+    }
+
+    /// @brief コンポーネントを作成
+    template<typename... Args>
+    T* create(Args&&... args)
+    {
+        Slot* slot = allocate();
+        T* obj = new (slot->storage) T(std::forward<Args>(args)...);
+        slot->alive = true;
+        obj->pool_ = this;
+        ++count_;
+        return obj;
+    }
+
+    virtual void destroy(Component* component) override
+    {
+        T* obj = static_cast<T*>(component);
+        Slot* slot = reinterpret_cast<Slot*>(reinterpret_cast<std::byte*>(obj));
+        obj->~T();
+        slot->alive = false;
+        slot->nextFree = freeList_;
+        freeList_ = slot;
+        --count_;
+    }
+
+    /// @brief 生きているコンポーネントをメモリの順に呼び出す
+    template<typename Func>
+    void forEach(Func&& func)
+    {
+        for (auto& chunk : chunks_)
+        {
+            for (size_t i = 0; i < ChunkSize; ++i)
+            {
+                if (chunk[i].alive) func(reinterpret_cast<T*>(chunk[i].storage));
+            }
+        }
+    }
+
+    size_t size() const { return count_; }
+
+private:
+    struct Slot
+    {
+        alignas(T) std::byte storage[sizeof(T)];
+        Slot* nextFree;
+        bool alive;
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    Slot* freeList_ = nullptr;
+    size_t count_ = 0;
+
+    Slot* allocate()
+    {
+        if (freeList_ == nullptr)
+        {
+            // チャンクを追加してフリーリストにつなぐ
+            auto chunk = std::make_unique<Slot[]>(ChunkSize);
+            for (size_t i = ChunkSize; i-- > 0;)
+            {
+                chunk[i].alive = false;
+                chunk[i].nextFree = freeList_;
+                freeList_ = &chunk[i];
+            }
+            chunks_.push_back(std::move(chunk));
+        }
+        Slot* slot = freeList_;
+        freeList_ = slot->nextFree;
+        return slot;
+    }
+};
+
+
+/// @brief コンポーネントを型ごとのプールに作成する
+template<typename T, typename... Args>
+ComponentPtr<T> MakeComponent(Args&&... args)
+{
+    return ComponentPtr<T>(ComponentPool<T>::instance().create(std::forward<Args>(args)...));
+}
+
+} // namespace UniDx
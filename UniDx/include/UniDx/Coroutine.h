@@ -0,0 +1,246 @@
+﻿/**
+ * @file Coroutine.h
+ * @brief Behaviour から開始するC++20のコルーチンと、その待機を管理するスケジューラ
+ */
+#pragma once
+
+#include <coroutine>
+#include <vector>
+#include <functional>
+#include <exception>
+#include <utility>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+class Behaviour;
+
+/**
+ * @brief コルーチンの戻り値の型。UnityのIEnumerator相当
+ * co_await WaitForSeconds(1.0f) などで待機しながら、複数フレームにわたる処理を書ける。
+ * 呼び出しただけでは実行されず、Behaviour::StartCoroutine() に渡すと最初の待機まで実行される。
+ * フレームはプールから確保するので、コルーチンはメインスレッドからのみ呼び出すこと
+ * @code
+ * Coroutine Door::Open()
+ * {
+ *     co_await WaitForSeconds(0.5f);
+ *     co_await WaitUntil([this]() { return isUnlocked; });
+ *     ...
+ * }
+ *
+ * StartCoroutine(Open());
+ * @endcode
+ */
+class Coroutine
+{
+public:
+    struct promise_type
+    {
+        uint32_t slot = UINT32_MAX; // スケジューラ内の位置
+
+        Coroutine get_return_object() { return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; } // 破棄はスケジューラが行う
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        // フレームはプールから確保する
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size) noexcept;
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Coroutine(Coroutine&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+
+    // 開始しなかったコルーチンはここで破棄する
+    ~Coroutine() { if (handle_) handle_.destroy(); }
+
+private:
+    Handle handle_;
+
+    explicit Coroutine(Handle handle) : handle_(handle) {}
+
+    friend class CoroutineScheduler;
+};
+
+
+/// @brief 実行中のコルーチンを指すハンドル。終了したコルーチンを指していても安全に使える
+struct CoroutineHandle
+{
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+
+/// @brief 次のフレームの Update() の後まで待つ。Unityの yield return null 相当
+struct WaitForNextFrame
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle handle) const;
+    void await_resume() const noexcept {}
+};
+
+
+/// @brief 指定した秒数が経過するまで待つ。Time::timeScale の影響を受ける
+struct WaitForSeconds
+{
+    float seconds;
+
+    explicit WaitForSeconds(float seconds) : seconds(seconds) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle handle) const;
+    void await_resume() const noexcept {}
+};
+
+
+/// @brief 指定した秒数が経過するまで待つ。Time::timeScale の影響を受けない
+struct WaitForSecondsRealtime
+{
+    float seconds;
+
+    explicit WaitForSecondsRealtime(float seconds) : seconds(seconds) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle handle) const;
+    void await_resume() const noexcept {}
+};
+
+
+/// @brief 次の FixedUpdate() と物理計算の後まで待つ
+struct WaitForFixedUpdate
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle handle) const;
+    void await_resume() const noexcept {}
+};
+
+
+/**
+ * @brief 条件が true になるまで待つ
+ * 条件は毎フレーム Update() の後に評価されるので、時間で待てるものは WaitForSeconds を使うこと。
+ * 最初から true なら待たずに続ける
+ */
+class WaitUntil
+{
+public:
+    explicit WaitUntil(std::function<bool()> predicate) : predicate_(std::move(predicate)) {}
+
+    bool await_ready() const { return predicate_(); }
+    void await_suspend(Coroutine::Handle handle) const;
+    void await_resume() const noexcept {}
+
+private:
+    std::function<bool()> predicate_; // 待機中はコルーチンのフレーム内にある
+};
+
+
+/// @brief 条件が true の間待つ。WaitUntil の逆
+class WaitWhile
+{
+public:
+    explicit WaitWhile(std::function<bool()> predicate) : predicate_(std::move(predicate)) {}
+
+    bool await_ready() const { return !predicate_(); }
+    void await_suspend(Coroutine::Handle handle) const;
+    void await_resume() const noexcept {}
+
+private:
+    std::function<bool()> predicate_;
+};
+
+
+/**
+ * @brief 実行中のコルーチンと、その待機を管理するクラス
+ * 待機の種類ごとにキューを持ち、秒数の待機は起きる時刻の順のヒープに入れるので、
+ * 眠っているコルーチンは毎フレームの処理に含まれない。毎フレーム評価するのは条件の待機だけ。
+ * キューのエントリは世代番号付きのハンドルで、停止したコルーチンのエントリは取り出すときに捨てる。
+ * メインスレッドからのみ使うこと
+ */
+class CoroutineScheduler : public Singleton<CoroutineScheduler>
+{
+public:
+    virtual ~CoroutineScheduler();
+
+    /// @brief owner のコルーチンとして開始し、最初の待機まで実行する
+    CoroutineHandle start(Behaviour* owner, Coroutine routine);
+
+    /// @brief 停止してフレームを破棄する。実行中のものは次に中断したところで破棄する
+    void stop(CoroutineHandle handle);
+
+    /// @brief owner の全てのコルーチンを停止する
+    void stopAll(Behaviour* owner);
+
+    bool isRunning(CoroutineHandle handle) const;
+
+    /// @brief 実行中のコルーチンの数
+    size_t size() const { return count_; }
+
+    // 待機の登録（待機用の型から呼ばれる）
+    void waitNextFrame(Coroutine::Handle handle);
+    void waitSeconds(Coroutine::Handle handle, float seconds, bool realtime);
+    void waitFixedUpdate(Coroutine::Handle handle);
+    void waitPredicate(Coroutine::Handle handle, const std::function<bool()>* predicate, bool expected);
+
+    /// @brief 物理計算の後に呼び、WaitForFixedUpdate で待っているものを再開する
+    void resumeFixedUpdate();
+
+    /// @brief Update() の後に呼び、次のフレーム・秒数・条件を待っているものを再開する
+    void resumeFrame();
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    struct Slot
+    {
+        Coroutine::Handle handle;
+        Behaviour* owner = nullptr;
+        uint32_t generation = 0;
+        uint32_t prev = None;       // owner のコルーチンのリスト
+        uint32_t next = None;       // 空きのときはフリーリスト
+        bool running = false;       // resume() の中
+        bool stopRequested = false; // 実行中に停止された
+    };
+
+    struct TimedWait
+    {
+        float wakeTime;
+        uint64_t order; // 同じ時刻なら待機した順に起こす
+        CoroutineHandle handle;
+    };
+
+    struct PredicateWait
+    {
+        const std::function<bool()>* predicate;
+        bool expected;
+        CoroutineHandle handle;
+    };
+
+    std::vector<Slot> slots_;
+    uint32_t freeSlot_ = None;
+    size_t count_ = 0;
+    uint64_t timedOrder_ = 0;
+
+    std::vector<CoroutineHandle> frameWaits_;
+    std::vector<CoroutineHandle> fixedWaits_;
+    std::vector<TimedWait> scaledWaits_;   // Time::time で起きる時刻の最小ヒープ
+    std::vector<TimedWait> realtimeWaits_; // Time::unscaledTime で起きる時刻の最小ヒープ
+    std::vector<PredicateWait> predicateWaits_;
+    std::vector<PredicateWait> predicateBatch_;
+    std::vector<CoroutineHandle> ready_;   // 今回再開するもの
+
+    CoroutineHandle handleOf(Coroutine::Handle handle) const;
+    bool isValid(CoroutineHandle handle) const { return handle.slot < slots_.size() && slots_[handle.slot].generation == handle.generation && slots_[handle.slot].handle; }
+    void popExpired(std::vector<TimedWait>& heap, float now);
+    void resumeReady();
+    void resume(CoroutineHandle handle);
+    void unlink(uint32_t slot);
+    void release(uint32_t slot);
+};
+
+} // namespace UniDx
@@ -38,6 +38,13 @@ public:
 	const ComPtr<ID3D11Device>&			GetDevice() const { return m_device; }
 	const ComPtr<ID3D11DeviceContext>&	GetContext() const { return m_context; }
 
+	/// @brief 作成済みのデバイス。D3DManager を作らずに抽出だけを検査するときは nullptr
+	static ID3D11Device* findDevice()
+	{
+		D3DManager* d3d = getInstance();
+		return d3d != nullptr ? d3d->m_device.Get() : nullptr;
+	}
+
 	// デストラクタ
 	~D3DManager();
 
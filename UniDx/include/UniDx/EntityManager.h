@@ -0,0 +1,346 @@
+﻿/**
+ * @file EntityManager.h
+ * @brief 同じ構成の大量のエンティティを、構成（アーキタイプ）ごとのチャンクに並べて処理する
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+#include <new>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+#include "JobSystem.h"
+#include "GameObject.h"
+
+namespace UniDx
+{
+
+class EntityManager;
+
+/// @brief エンティティの識別子。破棄した番号を再利用しても generation で区別する
+struct Entity
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isNull() const { return index == UINT32_MAX; }
+    bool operator==(const Entity& other) const = default;
+};
+
+
+/// @brief エンティティのコンポーネント型の情報
+struct EntityComponentType
+{
+    const void* id;   // ComponentTypeId<T>()
+    uint32_t size;
+    uint32_t align;
+
+    /// @brief T の型情報
+    /// エンティティのコンポーネントはチャンク内をメモリのコピーで移動するので、
+    /// コンストラクタやデストラクタに処理のない単純な構造体にすること
+    template<typename T>
+    static const EntityComponentType& of()
+    {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+            "entity components must be trivially copyable");
+        static const EntityComponentType type{ ComponentTypeId<T>(), uint32_t(sizeof(T)), uint32_t(alignof(T)) };
+        return type;
+    }
+};
+
+
+/**
+ * @brief 同じコンポーネント構成のエンティティの集まり
+ * ChunkBytes ごとのチャンクに、コンポーネントの種類ごとの配列（SoA）として並べる。
+ * 破棄したエンティティの位置には末尾のものを移すので、チャンクは常に前から詰まっている
+ */
+class EntityArchetype
+{
+public:
+    static constexpr size_t ChunkBytes = 16 * 1024;
+    static constexpr size_t ChunkAlign = 64;
+
+    /// @brief チャンク１つ分のエンティティ
+    struct Chunk
+    {
+        std::byte* data = nullptr;
+        uint32_t count = 0;
+    };
+
+    explicit EntityArchetype(std::vector<const EntityComponentType*> types);
+    ~EntityArchetype();
+
+    EntityArchetype(const EntityArchetype&) = delete;
+    EntityArchetype& operator=(const EntityArchetype&) = delete;
+
+    /// @brief 型を持っているか
+    bool has(const void* type) const { return find(type) >= 0; }
+
+    /// @brief 型の並びが一致するか（types は識別子順）
+    bool matches(const std::vector<const EntityComponentType*>& types) const { return types == types_; }
+
+    /// @brief チャンク内の T の配列の先頭
+    template<typename T>
+    T* getArray(const Chunk& chunk) const
+    {
+        const int i = find(ComponentTypeId<T>());
+        assert(i >= 0);
+        return reinterpret_cast<T*>(chunk.data + offsets_[i]);
+    }
+
+    Entity* getEntities(const Chunk& chunk) const { return reinterpret_cast<Entity*>(chunk.data); }
+
+    const std::vector<Chunk>& getChunks() const { return chunks_; }
+    size_t chunkCapacity() const { return capacity_; }
+    size_t size() const { return count_; }
+
+private:
+    std::vector<const EntityComponentType*> types_; // 識別子順
+    std::vector<uint32_t> offsets_;                 // チャンク内の各配列の位置
+    uint32_t capacity_ = 0;                         // チャンクあたりのエンティティ数
+    std::vector<Chunk> chunks_;
+    size_t count_ = 0;
+
+    int find(const void* type) const;
+
+    // 末尾に行を追加して (チャンク, 行) を返す
+    std::pair<uint32_t, uint32_t> addRow(Entity entity);
+
+    // 行を削除して末尾の行を移す。移したエンティティを返す（移さなかったときは null）
+    Entity removeRow(uint32_t chunk, uint32_t row);
+
+    void* getComponent(uint32_t chunk, uint32_t row, int typeIndex) const
+    {
+        return chunks_[chunk].data + offsets_[typeIndex] + size_t(row) * types_[typeIndex]->size;
+    }
+
+    friend class EntityManager;
+};
+
+
+/**
+ * @brief エンティティシステム。EntityManager::AddSystem() で登録すると、登録順に毎フレーム呼ばれる
+ * OnUpdate() では ForEach() や ParallelForEach() でエンティティを処理する
+ */
+class EntitySystem
+{
+public:
+    virtual ~EntitySystem() = default;
+    virtual void OnUpdate(EntityManager& entities) = 0;
+};
+
+
+/**
+ * @brief アーキタイプごとにエンティティを管理するクラス
+ * 多数の同じ構成のもの（群衆、弾、ロジック付きのパーティクルなど）をGameObjectを使わずに扱う。
+ * エンティティは作成時にコンポーネントの構成が決まり、後から追加や削除はできない。
+ * 作成すると、プレイヤーループが Update() の後に登録されたシステムを実行し、
+ * LocalTransform から LocalToWorld を計算して TransformLink の指すTransformに書き戻す。
+ * メインスレッドから使うこと。ParallelForEach() の中ではエンティティを作成・破棄しないこと
+ *
+ * @code
+ * EntityManager::create();
+ * auto* entities = EntityManager::getInstance();
+ * entities->CreateEntity(LocalTransform{ pos }, Velocity{ v }, LocalToWorld{}, RenderGroup{ 1 });
+ * entities->ParallelForEach<LocalTransform, Velocity>([dt](LocalTransform& t, Velocity& v) {
+ *     t.position += v.value * dt;
+ * });
+ * @endcode
+ */
+class EntityManager : public Singleton<EntityManager>
+{
+public:
+    /// @brief 並列処理の1ジョブにまとめるチャンクの数
+    size_t parallelGrain = 1;
+
+    EntityManager();
+    virtual ~EntityManager();
+
+    /// @brief コンポーネントの初期値を指定してエンティティを作成
+    template<typename... Ts>
+    Entity CreateEntity(const Ts&... values)
+    {
+        static std::vector<const EntityComponentType*> types = sortedTypes<Ts...>();
+        EntityArchetype* archetype = getOrCreateArchetype(types);
+        Entity entity = allocate(archetype);
+
+        const Record& r = records_[entity.index];
+        (new (archetype->getComponent(r.chunk, r.row, archetype->find(ComponentTypeId<Ts>()))) Ts(values), ...);
+        return entity;
+    }
+
+    /// @brief エンティティを破棄
+    void DestroyEntity(Entity entity);
+
+    /// @brief エンティティが破棄されていないか
+    bool Exists(Entity entity) const
+    {
+        return entity.index < records_.size() && records_[entity.index].generation == entity.generation
+            && records_[entity.index].archetype != nullptr;
+    }
+
+    /// @brief エンティティのコンポーネント。持っていなければ nullptr
+    template<typename T>
+    T* GetComponent(Entity entity) const
+    {
+        if (!Exists(entity)) return nullptr;
+        const Record& r = records_[entity.index];
+        const int i = r.archetype->find(ComponentTypeId<T>());
+        return i >= 0 ? static_cast<T*>(r.archetype->getComponent(r.chunk, r.row, i)) : nullptr;
+    }
+
+    /// @brief 生きているエンティティの数
+    size_t size() const { return count_; }
+
+    /**
+     * @brief Ts を全て持つエンティティに対して func を呼ぶ
+     * Ts に Entity を含めるとエンティティ自体も受け取れる
+     * @param func void(Ts&...)
+     */
+    template<typename... Ts, typename Func>
+    void ForEach(Func&& func)
+    {
+        forEachChunk<Ts...>([this, &func](EntityArchetype* archetype, const EntityArchetype::Chunk& chunk)
+            {
+                runChunk<Ts...>(archetype, chunk, func);
+            });
+    }
+
+    /**
+     * @brief Ts を全て持つエンティティに対して、チャンク単位で並列に func を呼ぶ
+     * func は複数のスレッドから呼ばれるので、引数のコンポーネント以外を変更しないこと
+     * @param func void(Ts&...)
+     */
+    template<typename... Ts, typename Func>
+    void ParallelForEach(Func&& func)
+    {
+        // 対象のチャンクを集めてから並列に実行
+        chunkList_.clear();
+        forEachChunk<Ts...>([this](EntityArchetype* archetype, const EntityArchetype::Chunk& chunk)
+            {
+                chunkList_.push_back({ archetype, &chunk });
+            });
+
+        JobSystem::parallelFor(chunkList_.size(), parallelGrain,
+            [this, &func](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    runChunk<Ts...>(chunkList_[i].archetype, *chunkList_[i].chunk, func);
+                }
+            });
+    }
+
+    /// @brief 毎フレーム実行するシステムを追加
+    template<typename T, typename... Args>
+    T* AddSystem(Args&&... args)
+    {
+        auto system = std::make_unique<T>(std::forward<Args>(args)...);
+        T* ptr = system.get();
+        systems_.push_back(std::move(system));
+        return ptr;
+    }
+
+    /// @brief システムを実行し、Transformとの橋渡しを行う（プレイヤーループから呼ばれる）
+    void Update();
+
+private:
+    // エンティティの番号ごとの格納場所
+    struct Record
+    {
+        EntityArchetype* archetype = nullptr; // 破棄済みなら nullptr
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    struct ChunkRef
+    {
+        EntityArchetype* archetype;
+        const EntityArchetype::Chunk* chunk;
+    };
+
+    std::vector<std::unique_ptr<EntityArchetype>> archetypes_;
+    std::vector<Record> records_;
+    std::vector<uint32_t> freeIndices_;
+    size_t count_ = 0;
+
+    std::vector<std::unique_ptr<EntitySystem>> systems_;
+    std::vector<ChunkRef> chunkList_; // ParallelForEach() の作業用
+
+    template<typename... Ts>
+    static std::vector<const EntityComponentType*> sortedTypes()
+    {
+        std::vector<const EntityComponentType*> types{ &EntityComponentType::of<Entity>(), &EntityComponentType::of<Ts>()... };
+        std::sort(types.begin() + 1, types.end(),
+            [](auto a, auto b) { return std::less<const void*>()(a->id, b->id); });
+        return types;
+    }
+
+    EntityArchetype* getOrCreateArchetype(const std::vector<const EntityComponentType*>& types);
+    Entity allocate(EntityArchetype* archetype);
+
+    // Ts を全て持つアーキタイプの、エンティティのあるチャンクを順に呼ぶ
+    template<typename... Ts, typename Func>
+    void forEachChunk(Func&& func)
+    {
+        for (auto& archetype : archetypes_)
+        {
+            if (!(archetype->has(ComponentTypeId<Ts>()) && ...)) continue;
+            for (auto& chunk : archetype->chunks_)
+            {
+                if (chunk.count > 0) func(archetype.get(), chunk);
+            }
+        }
+    }
+
+    template<typename... Ts, typename Func>
+    static void runChunk(EntityArchetype* archetype, const EntityArchetype::Chunk& chunk, Func& func)
+    {
+        std::tuple<Ts*...> arrays{ archetype->getArray<Ts>(chunk)... };
+        for (uint32_t i = 0; i < chunk.count; ++i)
+        {
+            func(std::get<Ts*>(arrays)[i]...);
+        }
+    }
+};
+
+
+// --------------------
+// Transformとの橋渡し
+// --------------------
+
+/// @brief エンティティのワールド空間の姿勢
+struct LocalTransform
+{
+    Vector3 position{ 0, 0, 0 };
+    Quaternion rotation;
+    Vector3 scale{ 1, 1, 1 };
+};
+
+/// @brief ワールド行列。Transform::localToWorldMatrix() と同じ形式で、LocalTransform から毎フレーム計算される
+struct LocalToWorld
+{
+    Matrix4x4 value = Matrix4x4::identity;
+};
+
+/// @brief 毎フレーム LocalTransform の位置と回転を書き込むTransform（Transform::getHandle() で作る）
+/// GameObjectのコライダーやレンダラーをエンティティに追従させるのに使う。
+/// Transformが破棄されるか Prefab のプールに戻されるとハンドルが無効になり、書き込まなくなる
+struct TransformLink
+{
+    TransformHandle transform;
+};
+
+/// @brief 描画する EntityRenderer の番号（EntityRenderer::group と一致するものが描画する）
+struct RenderGroup
+{
+    uint32_t value = 0;
+};
+
+} // namespace UniDx
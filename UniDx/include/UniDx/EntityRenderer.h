@@ -0,0 +1,30 @@
+﻿/**
+ * @file EntityRenderer.h
+ * @brief エンティティを LocalToWorld の位置にメッシュで描画するレンダラー
+ */
+#pragma once
+
+#include "Renderer.h"
+#include "EntityManager.h"
+
+namespace UniDx {
+
+/**
+ * @brief RenderGroup が group のエンティティを、LocalToWorld の位置に mesh と materials で描画するレンダラー
+ * どのGameObjectにアタッチしてもよく、自身のTransformは使わない。
+ * 行列用の定数バッファはエンティティの描画順に使い回す
+ */
+class EntityRenderer : public Renderer
+{
+public:
+    Mesh mesh;
+    uint32_t group = 0;
+
+    // 対象のエンティティの描画をパケットに写す
+    virtual void extract(FramePacket& packet) override;
+
+private:
+    std::vector<ComPtr<ID3D11Buffer>> buffers_; // エンティティごとの行列用の定数バッファ
+};
+
+} // namespace UniDx
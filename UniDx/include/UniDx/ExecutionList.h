@@ -0,0 +1,109 @@
+﻿/**
+ * @file ExecutionList.h
+ * @brief プレイヤーループの各段階で呼び出すコンポーネントのリスト
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "JobSystem.h"
+
+namespace UniDx
+{
+
+/**
+ * @brief プレイヤーループの各段階で呼び出すコンポーネントのリスト
+ * 要素は自身のリスト内の位置を Slot メンバに持ち、追加と削除は O(1) で行う。
+ * 実行中に削除された要素は nullptr にしておき、実行の終わりに詰める。
+ */
+template<class T, uint32_t T::* Slot>
+class ExecutionList
+{
+public:
+    static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+    bool contains(const T* item) const { return item->*Slot != InvalidSlot; }
+    size_t size() const { return items_.size(); }
+
+    void add(T* item)
+    {
+        if (contains(item)) return;
+        item->*Slot = (uint32_t)items_.size();
+        items_.push_back(item);
+    }
+
+    void remove(T* item)
+    {
+        if (!contains(item)) return;
+        items_[item->*Slot] = nullptr;
+        item->*Slot = InvalidSlot;
+        hasHoles_ = true;
+    }
+
+    /// @brief 登録順に呼び出す。呼び出し中の追加は今回の呼び出しに含まれる
+    template<typename Func>
+    void forEach(Func&& func)
+    {
+        ++iterating_;
+        for (size_t i = 0; i < items_.size(); ++i)
+        {
+            if (T* item = items_[i]) func(item);
+        }
+        --iterating_;
+        if (iterating_ == 0 && hasHoles_) compact();
+    }
+
+    /**
+     * @brief grain 個ずつに分けてワーカースレッドで並列に呼び出す
+     * 呼び出し中にこのリストへ追加・削除しないこと
+     */
+    template<typename Func>
+    void parallelForEach(size_t grain, Func&& func)
+    {
+        ++iterating_;
+        JobSystem::parallelFor(items_.size(), grain,
+            [this, &func](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (T* item = items_[i]) func(item);
+                }
+            });
+        --iterating_;
+        if (iterating_ == 0 && hasHoles_) compact();
+    }
+
+    /// @brief すべて削除
+    void clear()
+    {
+        for (T* item : items_)
+        {
+            if (item) item->*Slot = InvalidSlot;
+        }
+        items_.clear();
+        hasHoles_ = false;
+    }
+
+private:
+    std::vector<T*> items_;
+    int iterating_ = 0;
+    bool hasHoles_ = false;
+
+    // 削除された要素を詰めて位置を振り直す
+    void compact()
+    {
+        uint32_t n = 0;
+        for (T* item : items_)
+        {
+            if (item == nullptr) continue;
+            item->*Slot = n;
+            items_[n++] = item;
+        }
+        items_.resize(n);
+        hasHoles_ = false;
+    }
+};
+
+} // namespace UniDx
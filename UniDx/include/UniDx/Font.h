@@ -24,6 +24,9 @@ public:
 
 	DirectX::SpriteFont* getSpriteFont() const;
 
+protected:
+	virtual StringId getName() const override { return fileName; }
+
 private:
 	StringId fileName;
 	unique_ptr<DirectX::SpriteFont> spriteFont;
@@ -0,0 +1,126 @@
+﻿/**
+ * @file FramePacket.h
+ * @brief 1フレームの描画に必要な情報を、シミュレーションから切り離して保持する
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <span>
+
+#include "UniDxDefine.h"
+#include "ConstantBuffer.h"
+
+namespace UniDx
+{
+
+class Renderer;
+class SubMesh;
+class Mesh;
+class Material;
+
+
+/// @brief 描画の前に定数バッファへ転送するデータ
+struct FrameUpload
+{
+    ComPtr<ID3D11Buffer> buffer;   // デバイスなしで抽出したときは nullptr（転送はしない）
+    uint32_t offset;   // FramePacket::uploadData 内の位置
+    uint32_t size;
+};
+
+
+/// @brief Rendererひとつ分の描画
+struct FrameDraw
+{
+    const Renderer* renderer;            // 抽出元（検査用。描画時には参照しない）
+    Matrix4x4 world;
+    ComPtr<ID3D11Buffer> perObject;
+    ComPtr<ID3D11Buffer> lightPerObject; // ライトを使わなければ nullptr
+    uint32_t firstSubMesh = 0;           // FramePacket::subMeshes 内の位置
+    uint32_t subMeshCount = 0;
+    uint32_t firstMaterial = 0;          // FramePacket::materials 内の位置
+    uint32_t materialCount = 0;
+    uint32_t renderingModes = 0;         // マテリアルの RenderingMode のビット和
+};
+
+
+/**
+ * @brief 1フレームの描画に必要な情報
+ * 後更新の後にメインスレッドで抽出し、描画はこのパケットだけを使って行う。
+ * メッシュとマテリアルは共有ポインタ、定数バッファは参照カウントで持つので、
+ * 描画中に元のRendererやGameObjectが破棄されても構わない。
+ * 抽出ではD3Dのコンテキストを使わないので、描画せずに中身を検査できる。
+ * D3DManager を作らずに抽出したときは定数バッファが nullptr のまま転送だけが記録される。
+ */
+class FramePacket
+{
+public:
+    int   frameCount = 0;
+    Color clearColor = Color(0.35f, 0.55f, 0.9f, 1.0f);
+
+    // カメラ
+    bool hasCamera = false;
+    ConstantBufferPerCamera camera{};
+    ComPtr<ID3D11Buffer> cameraBuffer;
+
+    // フレーム共通のライト
+    ConstantBufferLightPerFrame lights{};
+    ComPtr<ID3D11Buffer> lightBuffer;
+
+    std::vector<FrameDraw> draws;
+    std::vector<std::shared_ptr<SubMesh>> subMeshes;
+    std::vector<std::shared_ptr<Material>> materials;
+    std::vector<FrameUpload> uploads;
+    std::vector<uint8_t> uploadData;
+
+    // UIなど、3D描画の後に順に実行する描画
+    std::vector<std::function<void()>> overlays;
+
+    /// @brief 次のフレームの抽出のために空にする（メモリは再利用）
+    void clear();
+
+    /// @brief 抽出ごとに振られる番号。共有されたものを１回だけ抽出するのに使う
+    uint64_t getSerial() const { return serial_; }
+
+    /// @brief 描画の前に buffer へ data を転送する（buffer が nullptr でも検査用に記録する）
+    void addUpload(const ComPtr<ID3D11Buffer>& buffer, const void* data, size_t size);
+    template<typename T>
+    void addUpload(const ComPtr<ID3D11Buffer>& buffer, const T& data) { addUpload(buffer, &data, sizeof(T)); }
+
+    /// @brief 描画を追加。続けて addMesh() でメッシュとマテリアルを設定する
+    FrameDraw& addDraw(const Renderer* renderer, const Matrix4x4& world,
+        const ComPtr<ID3D11Buffer>& perObject, const ComPtr<ID3D11Buffer>& lightPerObject);
+
+    /// @brief 最後に追加した描画のメッシュとマテリアルを設定
+    void addMesh(const Mesh& mesh, std::span<const std::shared_ptr<Material>> materials);
+
+    /// @brief D3Dのコンテキストに描画して画面に表示する（描画を行う1つのスレッドから呼ぶ）
+    void execute() const;
+
+    /// @brief mode のマテリアルを持つ描画を、その描画パスで描く順にたどる
+    template<typename Func>
+    void forEachDraw(RenderingMode mode, Func&& func) const
+    {
+        for (auto& draw : draws)
+        {
+            if ((draw.renderingModes & (1u << mode)) != 0) func(draw);
+        }
+    }
+
+    std::span<const std::shared_ptr<SubMesh>> getSubMeshes(const FrameDraw& draw) const
+    {
+        return std::span(subMeshes).subspan(draw.firstSubMesh, draw.subMeshCount);
+    }
+    std::span<const std::shared_ptr<Material>> getMaterials(const FrameDraw& draw) const
+    {
+        return std::span(materials).subspan(draw.firstMaterial, draw.materialCount);
+    }
+
+private:
+    uint64_t serial_ = 0;
+
+    void renderPass(RenderingMode mode) const;
+};
+
+} // namespace UniDx
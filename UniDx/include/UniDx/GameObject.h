@@ -5,35 +5,53 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <span>
+#include <algorithm>
+#include <functional>
 #include <type_traits>
 #include <typeinfo>
 #include <DirectXMath.h>
 
 #include "Object.h"
 #include "Collision.h"
+#include "ComponentPool.h"
+#include "CommandBuffer.h"
 
 namespace UniDx {
 
 
 // 前方宣言
 class Component;
+class Behaviour;
 class Transform;
 class Collider;
+class Prefab;
 
 /// @brief GameObjectを破棄
 void Destroy(GameObject* component);
 
+/// @brief 型ごとに一意な識別子（型ごとの静的変数のアドレス）
+template<typename T>
+const void* ComponentTypeId()
+{
+    static const char id = 0;
+    return &id;
+}
+
  /// @brief キャラクターや背景カメラなどの基礎となるオブジェクト
 class GameObject : public Object
 {
 public:
     Transform* transform;
 
-    const std::vector<std::unique_ptr<Component>>& GetComponents() const { return components; }
+    // 動かないオブジェクトか（Transform::setStatic を参照）
+    UNIDX_PROPERTY(GameObject, bool, isStatic, getStatic, setStatic);
+
+    const std::vector<ComponentPtr<Component>>& GetComponents() const { return components; }
 
     GameObject(const char* n = "GameObject") : GameObject(StringId::intern(std::string_view(n))) {}
     GameObject(const char8_t* n) : GameObject(StringId::intern(n)) {}
-    GameObject(StringId n) : Object([this](){return name_;}), name_(n), isCalledDestroy(false)
+    GameObject(StringId n) : name_(n), isCalledDestroy(false)
     {
         // デフォルトでTransformを追加
         transform = AddComponent<Transform>();
@@ -77,35 +95,55 @@ public:
     {
         first->gameObject = this;
         components.push_back(std::move(first));
+        invalidateTypeIndex();
         Add(std::forward<Rest>(rest)...);
     }
 
     template<typename T, typename... Args>
     T* AddComponent(Args&&... args) {
         static_assert(std::is_base_of_v<Component, T>, "T must be a Component");
-        auto comp = std::make_unique<T>(std::forward<Args>(args)...);
+        assert(CommandBuffer::current() == nullptr); // 並列更新中は CommandBuffer::addComponent() を使う
+        auto comp = MakeComponent<T>(std::forward<Args>(args)...);
         comp->gameObject = this;
         T* ptr = comp.get();
         components.push_back(std::move(comp));
+        invalidateTypeIndex();
         return ptr;
     }
 
     template<typename T>
     [[nodiscard]] T* GetComponent(bool includeInactive = false) {
-        for (auto& comp : components) {
-            auto casted = dynamic_cast<T*>(comp.get());
-            if (casted != nullptr && (comp->enabled || includeInactive && !comp->isDestroyed())) {
-                return casted;
+        for (Component* comp : findComponents<T>()) {
+            if (comp->enabled || includeInactive && !comp->isDestroyed()) {
+                return static_cast<T*>(comp);
             }
         }
         return nullptr;
     }
 
+    /**
+     * @brief T またはその派生クラスのコンポーネントを results に書き込む
+     * @return 書き込んだ数。results に入りきらない分は書き込まない
+     */
+    template<typename T>
+    size_t GetComponents(std::span<T*> results, bool includeInactive = false) {
+        size_t n = 0;
+        for (Component* comp : findComponents<T>()) {
+            if (n == results.size()) break;
+            if (comp->enabled || includeInactive && !comp->isDestroyed()) {
+                results[n++] = static_cast<T*>(comp);
+            }
+        }
+        return n;
+    }
+
     template<typename Predicate>
     GameObject* Find(Predicate pred) const;
 
     void SetName(StringId n) { name_ = n; }
-    bool checkDestroy();
+
+    /// @brief 作成元の Prefab。Prefab から作ったのでなければ nullptr
+    Prefab* getPrefab() const { return prefab_; }
 
     virtual void onTriggerEnter(Collider* other);
     virtual void onTriggerStay(Collider* other);
@@ -116,10 +154,73 @@ public:
 
 protected:
     StringId name_;
-    std::vector<std::unique_ptr<Component>> components;
+    std::vector<ComponentPtr<Component>> components;
     bool isCalledDestroy = false;
 
+    // 問い合わせのあった型ごとの、その型として使えるコンポーネントの一覧（型の識別子順）
+    // components を変更したら作り直す
+    struct TypeIndexEntry
+    {
+        const void* type;
+        uint32_t first; // typeIndexComponents_ 内の位置
+        uint32_t count;
+    };
+    std::vector<TypeIndexEntry> typeIndex_;
+    std::vector<Component*> typeIndexComponents_;
+
+    void invalidateTypeIndex() { typeIndex_.clear(); typeIndexComponents_.clear(); physicsListenersDirty_ = true; }
+
+    // T として使えるコンポーネントを components の順で取得
+    // 型ごとに最初の問い合わせでだけ dynamic_cast で調べ、以降は二分探索で引く
+    template<typename T>
+    std::span<Component* const> findComponents()
+    {
+        const void* type = ComponentTypeId<T>();
+        auto it = std::lower_bound(typeIndex_.begin(), typeIndex_.end(), type,
+            [](const TypeIndexEntry& e, const void* t) { return std::less<const void*>()(e.type, t); });
+        if (it == typeIndex_.end() || it->type != type)
+        {
+            TypeIndexEntry entry{ type, (uint32_t)typeIndexComponents_.size(), 0 };
+            for (auto& comp : components)
+            {
+                if (dynamic_cast<T*>(comp.get()) != nullptr)
+                {
+                    typeIndexComponents_.push_back(comp.get());
+                    ++entry.count;
+                }
+            }
+            it = typeIndex_.insert(it, entry);
+        }
+        return std::span<Component* const>(typeIndexComponents_.data() + it->first, it->count);
+    }
+
+    virtual StringId getName() const override { return name_; }
+
+private:
+    Prefab* prefab_ = nullptr;
+    bool destroyQueued_ = false; // PlayerLoop の削除待ちに入っている
+
+    // 物理のコールバックをオーバーライドしている可能性のある Behaviour
+    // コンポーネントの追加・削除やオーバーライドされていないと分かったときに、次の通知の前に作り直す
+    std::vector<Behaviour*> physicsListeners_;
+    bool physicsListenersDirty_ = true;
+
+    void invalidatePhysicsListeners() { physicsListenersDirty_ = true; }
+
+    // callback をオーバーライドしている可能性のある Behaviour に f を呼ぶ
+    template<typename F>
+    void dispatchPhysics(uint8_t callback, F&& f);
+
+    bool getStatic() const;
+    void setStatic(bool value);
+
+    // Destroy() が呼ばれたコンポーネントを削除
+    void removeDestroyedComponents();
+
     friend void Destroy(GameObject*);
+    friend class Prefab;
+    friend class PlayerLoop;
+    friend class Behaviour;
 };
 
 } // namespace UniDx
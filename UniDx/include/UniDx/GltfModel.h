@@ -7,6 +7,7 @@
 #include <tiny_gltf.h>
 
 #include "SkinnedMeshRenderer.h"
+#include "HierarchyBuilder.h"
 
 
 namespace UniDx {
@@ -116,7 +117,7 @@ public:
 protected:
     std::vector<MeshRenderer*> renderer;
     std::unordered_map<int, std::shared_ptr<Material>> materials;
-    std::unique_ptr< tinygltf::Model> model;
+    std::shared_ptr< tinygltf::Model> model; // 複製したモデルとは共有する
     std::vector< std::shared_ptr<Mesh> > meshes; // model->meshesの順に従ったメッシュ
     std::unordered_map<int, std::shared_ptr<Texture>> textures;
     std::unordered_map<int, Transform*> nodes;
@@ -124,8 +125,13 @@ protected:
 
     virtual bool load_(const char* filePath, bool makeTextureMaterial, std::shared_ptr<Shader> shader);
     virtual void readPrimitive(UniDx::Mesh* mesh, const tinygltf::Primitive& primitive);
-    virtual void createNodeRecursive(const tinygltf::Model& model, int nodeIndex, GameObject* parentGO, bool attachIncludeMaterial);
+    virtual void createNodeRecursive(const tinygltf::Model& model, int nodeIndex, int parentNode,
+        HierarchyBuilder& builder, std::vector<int>& builtNodes, bool attachIncludeMaterial);
     virtual std::shared_ptr<Texture> getOrCreateTextureFromGltf_(int textureIndex, bool isSRGB);
+
+    // 読み込んだデータは共有し、生成したノードとレンダラーへの参照は複製先のものに置き換える
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override;
+    virtual void resolveClone(const CloneMap& map) override;
 };
 
 
@@ -0,0 +1,77 @@
+﻿/**
+ * @file HierarchyBuilder.h
+ * @brief ノードの配列からGameObjectの階層をまとめて作成する
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "UniDxDefine.h"
+#include "Math.h"
+#include "StringId.h"
+#include "Component.h"
+
+namespace UniDx
+{
+
+class GameObject;
+class Transform;
+
+/**
+ * @brief ノードの配列からGameObjectの階層をまとめて作成するクラス
+ * モデルの読み込みやマップの生成のように多数のGameObjectを作るときに使う。
+ * 子の配列は最初に必要な数だけ確保し、姿勢はプロパティを通さず直接書き込んで、
+ * 最後にワールド行列を１回の更新でまとめて計算する。
+ */
+class HierarchyBuilder
+{
+public:
+    /// @brief 作成するGameObjectの情報
+    struct Node
+    {
+        StringId name;
+        int parent = -1;    // 親ノードのインデックス。-1 は build() に渡した親につなぐ
+        Vector3 localPosition = Vector3::zero;
+        Quaternion localRotation = Quaternion::identity;
+        Vector3 localScale = Vector3::one;
+        std::vector<ComponentPtr<Component>> components;
+    };
+
+    void reserve(size_t count) { nodes_.reserve(count); }
+    size_t size() const { return nodes_.size(); }
+
+    /**
+     * @brief ノードを追加してそのインデックスを返す
+     * 親は子より先に追加しておくこと
+     */
+    int add(StringId name, int parent,
+        const Vector3& localPosition = Vector3::zero,
+        const Quaternion& localRotation = Quaternion::identity,
+        const Vector3& localScale = Vector3::one);
+
+    /// @brief ノードを取得
+    Node& node(int index) { return nodes_[index]; }
+
+    /// @brief ノードにコンポーネントを追加
+    template<typename T, typename... Args>
+    T* addComponent(int index, Args&&... args)
+    {
+        auto comp = MakeComponent<T>(std::forward<Args>(args)...);
+        T* ptr = comp.get();
+        nodes_[index].components.push_back(std::move(comp));
+        return ptr;
+    }
+
+    /**
+     * @brief 階層を作成して root の子にする
+     * @return 作成したGameObject（ノードと同じ順）
+     * 作成後、ノードはすべて削除される
+     */
+    std::vector<GameObject*> build(Transform* root);
+
+private:
+    std::vector<Node> nodes_;
+};
+
+} // namespace UniDx
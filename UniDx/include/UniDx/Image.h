@@ -19,14 +19,14 @@ class Image : public UIBehaviour
 public:
 	Image();
 	virtual void OnEnable() override;
-	virtual void render(const Matrix4x4& proj) const override;
+	virtual void extract(FramePacket& packet, const Matrix4x4& proj) const override;
 
 	std::shared_ptr<Texture> texture;
 	void SetColor(Color c) { std::fill(colors.begin(), colors.end(), c); }
 
 private:
 	ComPtr<ID3D11Buffer> constantBufferPerObject;
-	std::unique_ptr<SubMesh> mesh;
+	std::shared_ptr<SubMesh> mesh; // 描画スレッドと共有
 	std::vector<Color> colors;
 };
 
@@ -0,0 +1,123 @@
+﻿/**
+ * @file JobSystem.h
+ * @brief ワーカースレッドでジョブを並列に実行する
+ */
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+/**
+ * @brief ジョブの完了待ちに使うカウンタ
+ * ジョブを登録すると増え、ジョブが終わると減る。0 になれば全て完了
+ */
+class JobCounter
+{
+public:
+    bool isDone() const { return count_.load(std::memory_order_acquire) == 0; }
+
+private:
+    std::atomic<int> count_ = 0;
+
+    friend class JobSystem;
+};
+
+
+/**
+ * @brief ワーカースレッドでジョブを並列に実行するクラス
+ * ワーカーごとにジョブの両端キューを持ち、自分のキューは後ろから取り出し、
+ * 空になったら他のワーカーのキューの前から盗んで実行する。
+ * ワーカー以外のスレッドから登録したジョブは共有のキューに入る。
+ * wait() は待っている間も登録済みのジョブを実行するので、ジョブの中から呼んでもよい。
+ */
+class JobSystem : public Singleton<JobSystem>
+{
+public:
+    using Job = std::function<void()>;
+
+    /// @param workerCount ワーカースレッド数。0 なら論理コア数 - 1
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    /// @brief ワーカースレッド数
+    size_t workerCount() const { return workers_.size(); }
+
+    /// @brief このスレッドの番号。ワーカーは 0 ～ workerCount() - 1、それ以外は workerCount()
+    size_t threadIndex() const;
+
+    /// @brief ジョブを登録する。counter を指定すると完了したときに減らす
+    void schedule(Job job, JobCounter* counter = nullptr);
+
+    /// @brief counter が 0 になるまで、ジョブを実行しながら待つ
+    void wait(const JobCounter& counter);
+
+    /**
+     * @brief [0, count) を grain 個ずつの区間に分けて並列に実行し、全て終わるまで待つ
+     * @param func void(size_t begin, size_t end)
+     * JobSystem が作られていないときは呼び出し元のスレッドでそのまま実行する
+     */
+    template<typename Func>
+    static void parallelFor(size_t count, size_t grain, Func&& func)
+    {
+        grain = std::max<size_t>(grain, 1);
+        JobSystem* js = getInstance();
+        if (js == nullptr || js->workers_.empty() || count <= grain)
+        {
+            if (count > 0) func(size_t(0), count);
+            return;
+        }
+
+        // 最初の区間は呼び出し元で実行し、残りをジョブにする
+        JobCounter counter;
+        for (size_t begin = grain; begin < count; begin += grain)
+        {
+            const size_t end = std::min(begin + grain, count);
+            js->schedule([&func, begin, end]() { func(begin, end); }, &counter);
+        }
+        func(size_t(0), grain);
+        js->wait(counter);
+    }
+
+private:
+    struct Entry
+    {
+        Job job;
+        JobCounter* counter;
+    };
+
+    // ジョブの両端キュー
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Entry> entries;
+    };
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_; // ワーカーごと + 最後はワーカー以外のスレッド用
+    std::atomic<int> pending_ = 0;               // キューに入っているジョブの数
+    std::atomic<bool> quit_ = false;
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+
+    void workerMain(size_t index);
+
+    // 実行できるジョブを1つ取り出す（自分のキューの後ろ、なければ他のキューの前から）
+    bool pop(size_t self, Entry& out);
+
+    void run(Entry& entry);
+};
+
+} // namespace UniDx
@@ -31,6 +31,7 @@ public:
 protected:
     virtual void OnEnable() override;
     virtual void OnDisable() override;
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
 };
 
 } // namespace UniDx
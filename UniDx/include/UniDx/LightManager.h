@@ -15,6 +15,7 @@ namespace UniDx
 {
 
 class Light;
+class FramePacket;
 
 struct GPULight // 16byte aligned
 {
@@ -44,14 +45,37 @@ public:
     bool registerLight(Light* light);
     void unregisterLight(Light* light);
 
-    // ライト情報を定数バッファに反映
-    virtual void updateLightCBuffer();
-    virtual void updateLightCBufferObject(Vector3 objPos, int lightCountMax = PointLightCountMax + SpotLightCountMax);
+    // フレーム共通のライト情報をパケットに写す
+    virtual void extract(FramePacket& packet);
+
+    // オブジェクトごとのライト情報を、指定した定数バッファへの転送としてパケットに写す
+    void extractLightCBufferObject(FramePacket& packet, Vector3 objPos, int lightCountMax, const ComPtr<ID3D11Buffer>& buffer);
+
+    // オブジェクトごとのライト情報用の定数バッファを作成
+    ComPtr<ID3D11Buffer> createLightCBufferObject();
+
+    // ライトの世代番号。extract() でいずれかのライトが変わっていたら増える
+    uint32_t getLightsVersion() const { return lightsVersion_; }
 
 private:
+    // 変更検出用に保存するライトの状態
+    struct LightState
+    {
+        Light* light;
+        uint32_t transformVersion;
+        Color color;
+        int type;
+        float intensity;
+        float range;
+        float spotAngle;
+    };
+
     std::vector<Light*> lights_;
     size_t              capacity_ = 0;
 
+    std::vector<LightState> lightStates_;
+    uint32_t lightsVersion_ = 1;
+
     std::vector<GPULight> gpuLights_;
     Microsoft::WRL::ComPtr<ID3D11Buffer>           lightBuf_;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>lightSRV_;
@@ -62,7 +86,6 @@ private:
     std::vector<float> pointLightIntensity;
     std::vector<float> spotLightIntensity;
     ComPtr<ID3D11Buffer> constantBufferLightPerFrame;  // フレームごとにGPUで共通利用する定数バッファ
-    ComPtr<ID3D11Buffer> constantBufferLightPerObject; // オブジェクトごとにGPUで共通利用する定数バッファ
 };
 
 }
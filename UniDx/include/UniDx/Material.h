@@ -12,6 +12,7 @@ namespace UniDx {
 
 class Camera;
 class Texture;
+class FramePacket;
 enum RenderingMode;
 
 
@@ -66,7 +67,10 @@ public:
     void SetVector(StringId name, Vector2 v) { SetVector(name, Vector4(v, 0.0f, 0.0f)); }
     void SetMatrix(StringId name, const Matrix4x4& m) { SetBytes(name, &m, sizeof(Matrix4x4)); }
 
-    // マテリアル情報設定。Render()内で呼び出す
+    // 変更されたマテリアル変数を描画用のパケットに写す。描画の前にメインスレッドで呼び出す
+    virtual void extract(FramePacket& packet);
+
+    // マテリアル情報設定。描画時に呼び出す
     virtual bool bind();
 
     // テクスチャの取得
@@ -93,9 +97,11 @@ protected:
 
     std::vector<uint8_t> cbStaging; // GPUへ転送するマテリアル変数
     bool dirty = true;
+    uint64_t extractedSerial_ = 0;  // 最後に抽出したパケットの番号
 
     void createConstantBuffer();
 
+    virtual StringId getName() const override { return shader->name; }
 };
 
 
@@ -244,7 +244,7 @@ class Mesh : public Object
 public:
     std::vector< std::shared_ptr<SubMesh> > submesh;
 
-    Mesh() : Object([this]() {return name_;}) {}
+    Mesh() {}
     virtual ~Mesh() {}
 
     void render() const
@@ -255,10 +255,15 @@ public:
         }
     }
 
-    void render(std::span<const std::shared_ptr<Material> > materials) const;
+    void render(std::span<const std::shared_ptr<Material> > materials) const { render(submesh, materials); }
+
+    // サブメッシュごとに対応するマテリアルを設定して描画
+    static void render(std::span<const std::shared_ptr<SubMesh> > submesh, std::span<const std::shared_ptr<Material> > materials);
     
 protected:
     StringId name_;
+
+    virtual StringId getName() const override { return name_; }
 };
 
 
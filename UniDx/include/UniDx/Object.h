@@ -15,9 +15,13 @@ class Object
 public:
     virtual ~Object() {}
 
-    ReadOnlyProperty<StringId> name;
+    UNIDX_READONLY_PROPERTY(Object, StringId, name, getName);
 
-    Object(ReadOnlyProperty<StringId>::Getter nameGet) : name(nameGet) {}
+protected:
+    Object() {}
+
+    // 名前の取得。派生クラスで名前の持ち方に合わせて実装する
+    virtual StringId getName() const { return StringId(); }
 };
 
 } // namespace UniDx
@@ -3,6 +3,10 @@
 #include <vector>
 #include <array>
 #include <map>
+#include <span>
+#include <atomic>
+#include <memory>
+#include <functional>
 
 #include "Property.h"
 #include "Singleton.h"
@@ -28,7 +32,7 @@ struct ContactManifold
 {
     PhysicsShape* a;
     PhysicsShape* b;
-    std::array<Contact, 4> contacts;  // 1〜4点
+    std::array<Contact, Collision::ContactCountMax> contacts;  // 1〜4点
     int numContacts;
 };
 
@@ -37,6 +41,7 @@ class SpheresGeometory;
 class CapsulesGeometory;
 class BoxGeometory;
 class PhysicsGrid;
+class PhysicsGridTuner;
 
 
 // --------------------
@@ -81,10 +86,55 @@ public:
         correctVelocityBounds.Encapsulate(vec);
     }
 
+    // 物理LOD
+    int getLodLevel() const { return lodLevel_; }
+    void setLodLevel(int level) { lodLevel_ = level; }
+    uint32_t getLodPhase() const { return lodPhase_; }
+    float getLodStep() const { return lodStep_; }
+    bool isSimulating() const { return lodStep_ > 0.0f; }
+
+    // 静的なアクタはこのステップで計算しない
+    // 静的でなくなったときに止まっていた時間をまとめて進めないよう、最後に計算したステップも進める
+    float holdStep(uint32_t stepIndex)
+    {
+        lodStep_ = 0.0f;
+        lastStep_ = stepIndex;
+        return lodStep_;
+    }
+
+    // LODの計算開始。ステップ番号と計算の周期をずらす位相を設定
+    void initLod(uint32_t stepIndex, uint32_t phase)
+    {
+        lodLevel_ = 0;
+        lodPhase_ = phase;
+        lastStep_ = stepIndex;
+    }
+
+    // このステップで計算するかを決める
+    // 計算する場合は前回計算してからの経過時間を返し、しない場合は 0 を返す
+    float beginStep(uint32_t stepIndex, float step)
+    {
+        const uint32_t interval = 1u << lodLevel_;
+        const uint32_t elapsed = stepIndex - lastStep_;
+        if (((stepIndex + lodPhase_) & (interval - 1)) != 0 && elapsed < interval)
+        {
+            lodStep_ = 0.0f;
+            return lodStep_;
+        }
+        lodStep_ = step * float(elapsed);
+        lastStep_ = stepIndex;
+        return lodStep_;
+    }
+
 private:
     Rigidbody* rigidbody_;
     Bounds correctPositionBounds;
     Bounds correctVelocityBounds;
+
+    int lodLevel_ = 0;      // 0:毎ステップ 1:1/2 2:1/4
+    uint32_t lodPhase_ = 0; // 同じLODのアクタの計算ステップを分散させる位相
+    uint32_t lastStep_ = 0; // 最後に計算したステップ番号
+    float lodStep_ = 0.0f;  // 今回のステップで進める時間。計算しないときは 0
 };
 
 
@@ -97,10 +147,17 @@ public:
     void initialize(Collider* collider);
 
     Bounds moveBounds;  // コライダーの bounds に移動量を広げた範囲
-    PhysicsActor* actor;
+    PhysicsActor* actor = nullptr;
 
     Collider* getCollider() const { return collider_; }
     bool isValid() const { return collider_ != nullptr; }
+
+    // このステップで判定結果を更新するか。動かないコライダーは常に更新
+    bool isStepping() const { return actor == nullptr || static_ || actor->isSimulating(); }
+
+    // 静的なTransformについているか（moveBounds は静的になったときのまま使う）
+    bool isStatic() const { return static_; }
+    void setStatic(bool value) { static_ = value; }
     void setInvalid() { collider_ = nullptr; }
     void initOtherNew() { triggersNew_.clear(); collisionsNew_.clear(); }
     void addCollide(const Collision& col) { collisionsNew_.push_back(col); }
@@ -108,7 +165,8 @@ public:
     void collideCallback();
 
 private:
-    Collider* collider_;
+    Collider* collider_ = nullptr;
+    bool static_ = false;
 
     std::vector<Collision> collisions_;
     std::vector<Collision> collisionsNew_;
@@ -118,25 +176,118 @@ private:
 
 
 // --------------------
-// Physics
+// PhysicsSnapshot
+// --------------------
+enum PhysicsShapeType
+{
+    PhysicsShapeType_AABB,
+    PhysicsShapeType_Sphere,
+};
+
+// ワールド空間に変換済みの形状データ
+struct PhysicsShapeData
+{
+    Collider* collider; // 識別用。別スレッドからはメンバにアクセスしないこと
+    PhysicsShapeType type;
+    bool isTrigger;
+    Bounds bounds;      // ワールド空間の境界。AABB ではこれが形状そのもの
+    Vector3 center;     // 球の中心
+    float radius;       // 球の半径
+};
+
+/**
+ * @brief ステップ終了時点の形状をコピーした読み取り専用データ
+ * Transform や Collider を参照しないので、Update 中に任意のスレッドから問い合わせできる
+ */
+class PhysicsSnapshot
+{
+public:
+    uint32_t stepCount = 0;
+    std::vector<PhysicsShapeData> shapes;
+
+    /**
+     * @brief origin, direction, maxDistance, filter (デフォルト nullptr => 全て含める)
+     * @return コライダーにヒットしたとき true
+     */
+    bool Raycast(Vector3 origin, Vector3 direction, float maxDistance,
+        RaycastHit* hitInfo = nullptr, std::function<bool(const PhysicsShapeData&)> filter = nullptr) const;
+
+    /// @brief 球と重なっている形状のコライダーを results に追加して、その数を返す
+    size_t OverlapSphere(Vector3 center, float radius, std::vector<Collider*>& results) const;
+};
+
+
 // --------------------
-class Physics : public Singleton<Physics>
+// PhysicsWorld
+// --------------------
+/**
+ * @brief 独立してシミュレーションされる物理空間
+ * Collider と Rigidbody は setPhysicsWorld() で登録先を指定でき、指定しなければデフォルトの Physics に登録される。
+ * ワールドを指定していない Collider は attachedRigidbody のワールドに登録される。
+ * 複数のワールドは SimulateParallel() で並列に計算できる。
+ * 異なるワールドの剛体が剛体でない親 Transform を共有するのは構わないが、
+ * 別のワールドで動く剛体の子孫にはできない（デバッグビルドでは assert する）。
+ */
+class PhysicsWorld
 {
 public:
     typedef std::pair<PhysicsShape*, PhysicsShape*> PotentialPair;
 
-    static inline float gravity = -9.81f;
+    float gravity = -9.81f;
+
+    /**
+     * @brief 物理LODの設定
+     * focus から遠い Rigidbody ほど計算の頻度を下げ、まとめて大きなステップで進める
+     */
+    struct LodSettings
+    {
+        bool enabled = false;
+        Vector3 focus;                      // 毎ステップ計算する中心（カメラやプレイヤーの位置）
+        float halfRateDistance = 30.0f;     // これより遠いと 1/2 の頻度
+        float quarterRateDistance = 60.0f;  // これより遠いと 1/4 の頻度
+        uint32_t reassignInterval = 8;      // 距離によるLODの再計算を何ステップに分散するか
+    };
+    LodSettings lod;
+
+    /**
+     * @brief ブロードフェーズのパラメータ
+     * autoTuneBroadphase で調整された値を取得してレベルデータに保存し、読み込み時に設定できる
+     */
+    struct BroadphaseSettings
+    {
+        bool useGrid = true;    // false なら総当たり
+        int nodeDivide = 8;     // グリッドの分割数
+        int maxPerCell = 16;    // セルを分割するShape数
+    };
+
+    // ブロードフェーズのパラメータを計測しながら自動調整するか
+    bool autoTuneBroadphase = false;
 
-    Physics();
+    const BroadphaseSettings& getBroadphaseSettings() const { return broadphase_; }
+    void setBroadphaseSettings(const BroadphaseSettings& settings);
+
+    PhysicsWorld();
+    virtual ~PhysicsWorld();
 
     void simulate(float setp);
     void simulatePositionCorrection(float step);
 
+    /**
+     * @brief 複数のワールドを並列にシミュレート
+     * 先に TransformHierarchy を更新してから、判定と解決だけをワーカースレッドで行い、
+     * OnCollision～, OnTrigger～ のコールバックは全てのワールドの計算が終わった後に、
+     * 呼び出したスレッドでワールドの順に呼ぶ
+     */
+    static void SimulateParallel(std::span<PhysicsWorld* const> worlds, float step);
+
     void registerRigidbody(Rigidbody* rigidbody);
     void unregisterRigidbody(Rigidbody* rigidbody);
     void register3d(Collider* collider);
     void unregister3d(Collider* collider);
 
+    /// @brief rigidbody についている Collider のうち、登録先が変わったものを登録し直す
+    void updateColliderWorlds(Rigidbody* rigidbody);
+
     /**
      * @brief origin, direction, maxDistance, filter (デフォルト nullptr => 全て含める)
      * @return コライダーにヒットしたとき true
@@ -144,6 +295,12 @@ public:
     bool Raycast(Vector3 origin, Vector3 direction, float maxDistance,
         RaycastHit* hitInfo = nullptr, std::function<bool(const Collider*)> filter = nullptr);
 
+    /**
+     * @brief 直前のステップ終了時点のスナップショットを取得。どのスレッドからでも呼べる
+     * 保持している間は次のステップで上書きされない
+     */
+    std::shared_ptr<const PhysicsSnapshot> getSnapshot() const { return snapshot_.load(); }
+
     void checkBounds(PhysicsShape* shape1, PhysicsShape* shape2);
 
 private:
@@ -155,10 +312,35 @@ private:
     std::map<Rigidbody*, PhysicsActor> physicsActors;
     std::vector<PhysicsShape> physicsShapes;
     std::unique_ptr<PhysicsGrid> physicsGrid;
+    std::unique_ptr<PhysicsGridTuner> gridTuner;
+    BroadphaseSettings broadphase_;
+
+    uint32_t stepCount = 0;
+    uint32_t actorSerial = 0;
+
+    // 公開中のスナップショットと、作成用のダブルバッファ
+    std::atomic<std::shared_ptr<const PhysicsSnapshot>> snapshot_;
+    std::array<std::shared_ptr<PhysicsSnapshot>, 2> snapshotBuffers_;
+    int snapshotBack_ = 0;
 
     void initializeSimulate(float step);
+    void stepPositionCorrection(float step);
+    void dispatchCallbacks();
+    float updateLod(PhysicsActor& actor, float step);
+    void publishSnapshot();
     void solveVelocityConstraint(Rigidbody* A, Rigidbody* B, const ContactManifold& m);
     void solvePositionConstraint(Rigidbody* A, Rigidbody* B, const ContactManifold& m);
 };
 
+
+// --------------------
+// Physics
+// --------------------
+/// @brief デフォルトの物理ワールド
+class Physics : public PhysicsWorld, public Singleton<Physics>
+{
+public:
+    Physics() {}
+};
+
 }
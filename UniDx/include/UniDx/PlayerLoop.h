@@ -8,6 +8,11 @@
 #include <Keyboard.h>
 
 #include "Singleton.h"
+#include "ExecutionList.h"
+#include "Behaviour.h"
+#include "Renderer.h"
+#include "FramePacket.h"
+#include "RenderThread.h"
 
 namespace UniDx
 {
@@ -18,7 +23,14 @@ class Canvas;
 
 /**
  * @brief フレームワーク全体のループ処理を行うクラス。
- * Unityでは実行リストが作られるが、簡略化のため、全てのGameObjectとComponentを巡回して実行する。
+ * Unityと同様に、有効なコンポーネントは段階ごとの実行リストに登録され、
+ * 各段階ではGameObjectを巡回せずにリストの順に呼び出す。
+ * Start() を待っている Behaviour は別のキューに入り、次の update() でまとめて呼ばれる。
+ * コルーチンは Update() の後（WaitForFixedUpdate は物理計算の後）に再開する。
+ * Destroy() されたものは削除待ちのキューに入り、フレームの終わりにそれだけを削除する。
+ * 描画は後更新の後に必要な情報を FramePacket に抽出し、描画スレッドがそれを描画している間に
+ * メインスレッドは次のフレームのシミュレーションに進む。
+ * 各段階は Profiler のゾーンとして記録される。
  */
 class PlayerLoop : public Singleton<PlayerLoop>
 {
@@ -37,29 +49,68 @@ public:
         DirectX::Keyboard::ProcessMessage(message, wParam, lParam);
     }
 
+    /// @brief ParallelUpdate() の1ジョブにまとめる Behaviour の数
+    size_t parallelUpdateGrain = 16;
+
+    /**
+     * @brief 描画がシミュレーションから遅れてよいフレーム数（1 か 2）
+     * 0 なら描画スレッドを使わず、抽出したその場でメインスレッドで描画する。Initialize() の前に設定する
+     */
+    int frameLatency = 1;
+
+    /// @brief 現在のシーンの描画に必要な情報をパケットに写す（D3Dのコンテキストは使わない）
+    void extract(FramePacket& packet);
+
     void registerCanvas(Canvas* c);
     void unregisterCanvas(Canvas* c);
 
+    /// @brief 有効になった Behaviour を実行リストに登録（オーバーライドされていないメソッドのリストからは外す）
+    void registerBehaviour(Behaviour* b, bool waitStart);
+    void unregisterBehaviour(Behaviour* b);
+    void registerRenderer(Renderer* r);
+    void unregisterRenderer(Renderer* r);
+
+    /// @brief 自身かコンポーネントが Destroy() されたGameObjectを削除待ちに入れる
+    void enqueueDestroy(GameObject* gameObject);
+
+    /// @brief 削除待ちから外す（削除待ちのまま別の経路で破棄されたとき）
+    void cancelDestroy(GameObject* gameObject);
+
 protected:
     virtual void fixedUpdate();
     virtual void physics();
+    virtual void updateTransforms();
     virtual void input();
     virtual void update();
+    virtual void parallelUpdate();
+    virtual void updateEntities();
     virtual void lateUpdate();
     virtual void render();
     virtual void checkDestroy();
     virtual void finalize();
 
     void awake(GameObject* object);
-    void fixedUpdate(GameObject* object);
-    void checkStart(GameObject* object);
-    void update(GameObject* object);
-    void lateUpdate(GameObject* object);
-    void render(GameObject* object, const Camera& camera);
+    void checkStart();
 
 private:
     std::vector<Canvas*> canvas_;
 
+    std::unique_ptr<RenderThread> renderThread_;
+    FramePacket framePacket_; // 描画スレッドを使わないときのパケット
+
+    // 段階ごとの実行リスト
+    ExecutionList<Behaviour, &Behaviour::fixedUpdateSlot_> fixedUpdateList_;
+    ExecutionList<Behaviour, &Behaviour::updateSlot_> updateList_;
+    ExecutionList<Behaviour, &Behaviour::lateUpdateSlot_> lateUpdateList_;
+    ExecutionList<Behaviour, &Behaviour::parallelUpdateSlot_> parallelUpdateList_;
+    ExecutionList<Behaviour, &Behaviour::startSlot_> startQueue_;
+    ExecutionList<Renderer, &Renderer::renderSlot_> rendererList_; // new で作ったもの（プールのものはプールを走査する）
+
+    // 削除待ちのGameObject（処理中に Destroy() されたものは destroyQueue_ に入る）
+    std::vector<GameObject*> destroyQueue_;
+    std::vector<GameObject*> destroyBatch_;
+    std::vector<GameObject*> destroyTargets_;
+
     void createScene();
 };
 
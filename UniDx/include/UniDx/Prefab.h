@@ -0,0 +1,122 @@
+﻿/**
+ * @file Prefab.h
+ * @brief テンプレートのGameObjectを複製し、使い終わったインスタンスをプールして再利用する
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <type_traits>
+
+#include "GameObject.h"
+#include "Transform.h"
+
+namespace UniDx
+{
+
+/**
+ * @brief 複製元から複製先への対応表
+ * Component::clone() で登録し、Component::resolveClone() で複製元を指しているポインタを置き換えるのに使う。
+ * GameObject, Transform, 複製したコンポーネントは Prefab が登録する
+ */
+class CloneMap
+{
+public:
+    /// @brief 複製元と複製先の対応を登録
+    template<typename T>
+    void add(const T* source, T* clone)
+    {
+        if constexpr (std::is_base_of_v<Component, T>)
+        {
+            components_[source] = clone;
+        }
+        else
+        {
+            others_[source] = clone;
+        }
+    }
+
+    /// @brief 複製先を取得。登録されていなければ（階層の外を指していれば）source をそのまま返す
+    template<typename T>
+    T* operator()(T* source) const
+    {
+        if constexpr (std::is_base_of_v<Component, T>)
+        {
+            auto it = components_.find(source);
+            return it != components_.end() ? static_cast<T*>(it->second) : source;
+        }
+        else
+        {
+            auto it = others_.find(source);
+            return it != others_.end() ? static_cast<T*>(it->second) : source;
+        }
+    }
+
+    void clear() { components_.clear(); others_.clear(); }
+
+private:
+    // コンポーネントは基底クラスのポインタで引く
+    std::unordered_map<const Component*, Component*> components_;
+    std::unordered_map<const void*, void*> others_;
+};
+
+
+/**
+ * @brief テンプレートのGameObjectを複製してインスタンスを作るクラス
+ * テンプレートの階層を、コンポーネントごとの Component::clone() で複製する。
+ * Release() したインスタンスは破棄せずに無効にしてプールし、次の Instantiate() で再利用する。
+ * 再利用したときも OnEnable(), OnDisable() は呼ばれるが、Awake(), Start() は最初の１回だけ。
+ * Release() したインスタンスの TransformHandle は無効になり、再利用したものは別のハンドルになる。
+ * 有効・無効を切り替えるのは複製したコンポーネントだけで、それぞれ複製元のテンプレートの有効状態に合わせる。
+ * 後から追加したコンポーネントやGameObjectには触れないので、Release() の前に外すか自分で無効にすること。
+ * インスタンスより先に Prefab を破棄しないこと
+ */
+class Prefab
+{
+public:
+    /// @param source テンプレート。シーンには置かず、Prefab が所有する
+    /// @param prewarm あらかじめ作ってプールしておくインスタンスの数
+    explicit Prefab(unique_ptr<GameObject> source, size_t prewarm = 0);
+
+    GameObject* getSource() const { return source_.get(); }
+
+    /// @brief プールしているインスタンスの数
+    size_t pooledCount() const { return pool_.size(); }
+
+    /// @brief プールしているインスタンスが count 個になるまで作っておく
+    void Prewarm(size_t count);
+
+    /// @brief インスタンスを parent の子にして有効にする
+    GameObject* Instantiate(Transform* parent);
+
+    /// @brief インスタンスをワールド空間の position, rotation に置いて parent の子にし、有効にする
+    GameObject* Instantiate(Transform* parent, Vector3 position, Quaternion rotation);
+
+    /// @brief インスタンスを無効にして親から外し、プールに戻す
+    /// 並列更新中は CommandBuffer に記録される
+    void Release(GameObject* instance);
+
+private:
+    unique_ptr<GameObject> source_;
+    std::vector<unique_ptr<GameObject>> pool_;
+    CloneMap cloneMap_;
+
+    // プールから取り出すか新しく作ったインスタンスを、テンプレートと同じローカル姿勢で parent の子にする
+    GameObject* attach(Transform* parent);
+
+    // テンプレートを複製して、無効のままのインスタンスを作る
+    unique_ptr<GameObject> createInstance();
+    unique_ptr<GameObject> cloneRecursive(const GameObject* source);
+    void resolveRecursive(GameObject* instance);
+
+    // 複製したコンポーネントを、複製元と同じ有効状態にする
+    static void activateRecursive(GameObject* instance);
+    static void deactivateRecursive(GameObject* instance);
+};
+
+
+/// @brief Prefab から作ったものはプールに戻し、それ以外は Destroy() する
+void Release(GameObject* gameObject);
+
+} // namespace UniDx
@@ -12,25 +12,25 @@ class CubeRenderer : public MeshRenderer
 {
 public:
     template<typename TVertex>
-    static std::unique_ptr<CubeRenderer> create(const u8string& shaderPath)
+    static ComponentPtr<CubeRenderer> create(const u8string& shaderPath)
     {
-        auto ptr = std::unique_ptr<CubeRenderer>(new CubeRenderer());
+        auto ptr = MakeComponent<CubeRenderer>();
         ptr->AddMaterial<TVertex>(shaderPath);
         ptr->setCreateBudderType<TVertex>();
         return ptr;
     }
     template<typename TVertex>
-    static std::unique_ptr<CubeRenderer> create(const u8string& shaderPath, const u8string& texturePath)
+    static ComponentPtr<CubeRenderer> create(const u8string& shaderPath, const u8string& texturePath)
     {
-        auto ptr = std::unique_ptr<CubeRenderer>(new CubeRenderer());
+        auto ptr = MakeComponent<CubeRenderer>();
         ptr->AddMaterial<TVertex>(shaderPath, texturePath);
         ptr->setCreateBudderType<TVertex>();
         return ptr;
     }
     template<typename TVertex>
-    static std::unique_ptr<CubeRenderer> create(std::shared_ptr<Material> material)
+    static ComponentPtr<CubeRenderer> create(std::shared_ptr<Material> material)
     {
-        auto ptr = std::unique_ptr<CubeRenderer>(new CubeRenderer());
+        auto ptr = MakeComponent<CubeRenderer>();
         ptr->AddMaterial(material);
         ptr->setCreateBudderType<TVertex>();
         return ptr;
@@ -43,6 +43,7 @@ public:
 
 protected:
     virtual void OnEnable() override;
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
 
     std::function<void(SubMesh*)> createBufer_;
 };
@@ -55,25 +56,25 @@ class SphereRenderer : public MeshRenderer
 {
 public:
     template<typename TVertex>
-    static std::unique_ptr<SphereRenderer> create(const u8string& shaderPath)
+    static ComponentPtr<SphereRenderer> create(const u8string& shaderPath)
     {
-        auto ptr = std::unique_ptr<SphereRenderer>(new SphereRenderer());
+        auto ptr = MakeComponent<SphereRenderer>();
         ptr->AddMaterial<TVertex>(shaderPath);
         ptr->setCreateBudderType<TVertex>();
         return ptr;
     }
     template<typename TVertex>
-    static std::unique_ptr<SphereRenderer> create(const u8string& shaderPath, const u8string& texturePath)
+    static ComponentPtr<SphereRenderer> create(const u8string& shaderPath, const u8string& texturePath)
     {
-        auto ptr = std::unique_ptr<SphereRenderer>(new SphereRenderer());
+        auto ptr = MakeComponent<SphereRenderer>();
         ptr->AddMaterial<TVertex>(shaderPath, texturePath);
         ptr->setCreateBudderType<TVertex>();
         return ptr;
     }
     template<typename TVertex>
-    static std::unique_ptr<SphereRenderer> create(std::shared_ptr<Material> material)
+    static ComponentPtr<SphereRenderer> create(std::shared_ptr<Material> material)
     {
-        auto ptr = std::unique_ptr<SphereRenderer>(new SphereRenderer());
+        auto ptr = MakeComponent<SphereRenderer>();
         ptr->AddMaterial(material);
         ptr->setCreateBudderType<TVertex>();
         return ptr;
@@ -92,6 +93,7 @@ protected:
     static void createVertex();
 
     virtual void OnEnable() override;
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
 
     std::function<void(SubMesh*)> createBufer_;
 };
@@ -0,0 +1,189 @@
+﻿/**
+ * @file Profiler.h
+ * @brief 処理時間をゾーンごとに記録する階層的なCPUプロファイラ
+ */
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <ostream>
+#include <typeinfo>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+
+// 0 にすると計測のマクロをコンパイル時に取り除く
+#ifndef UNIDX_PROFILER
+#define UNIDX_PROFILER 1
+#endif
+
+namespace UniDx
+{
+
+/// @brief ゾーンの識別子。UNIDX_PROFILE_ZONE() ではハッシュをコンパイル時に計算する
+struct ProfileZoneId
+{
+    const char* name;
+    uint32_t hash;
+
+    constexpr ProfileZoneId(const char* name) : name(name), hash(Hash(name)) {}
+
+    /// @brief 名前のハッシュ（FNV-1a）
+    static constexpr uint32_t Hash(const char* s)
+    {
+        uint32_t h = 2166136261u;
+        for (; *s != '\0'; ++s)
+        {
+            h = (h ^ uint8_t(*s)) * 16777619u;
+        }
+        return h;
+    }
+};
+
+
+/// @brief 記録されたゾーン１つ
+struct ProfileEvent
+{
+    const char* name;
+    uint32_t hash;
+    uint32_t depth; // 同じスレッドで囲んでいるゾーンの数
+    int64_t begin;  // Profiler::now() の値（ナノ秒）
+    int64_t end;
+};
+
+
+/// @brief ゾーンごとの処理時間の統計（ミリ秒）
+struct ProfileStats
+{
+    const char* name = nullptr;
+    size_t count = 0;
+    double mean = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+};
+
+
+/**
+ * @brief 処理時間をゾーンごとに記録するCPUプロファイラ
+ * ゾーンは終了時にスレッドごとのリングバッファに書き込まれ、古いものから上書きされる。
+ * 書き込みはスレッド内で完結するので、ワーカースレッドや描画スレッドからも記録できる。
+ * 無効な間の計測のコストは、フラグを１つ読むだけ。
+ * 記録したものは Chrome の chrome://tracing や Perfetto で開けるJSONに書き出すか、
+ * getStats() で平均・95パーセンタイル・最大を得られるので、製品ビルドでも処理落ちの原因を調べられる
+ */
+class Profiler
+{
+public:
+    /// @brief スレッドごとに保持するゾーンの数
+    static constexpr size_t RingCapacity = 1 << 15;
+
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool value) { enabled_.store(value, std::memory_order_relaxed); }
+
+    /// @brief Behaviour や Renderer の型ごとのゾーンも記録するか（数が多いので既定では記録しない）
+    static bool isComponentZonesEnabled() { return isEnabled() && componentZones_.load(std::memory_order_relaxed); }
+    static void setComponentZonesEnabled(bool value) { componentZones_.store(value, std::memory_order_relaxed); }
+
+    /// @brief このスレッドの名前を設定する（書き出したトレースに表示される）
+    static void setThreadName(const char* name);
+
+    /// @brief 現在の時刻（ナノ秒）
+    static int64_t now();
+
+    /// @brief これまでの記録を捨てる（以降に終了したゾーンだけを扱う）
+    static void clear();
+
+    /// @brief 記録されているゾーンを全スレッド分取得する
+    static void collect(std::vector<ProfileEvent>& events, std::vector<uint32_t>* threadIds = nullptr);
+
+    /// @brief 記録されている name のゾーンの統計
+    static ProfileStats getStats(const char* name);
+
+    /// @brief 記録されている全てのゾーンの統計（合計時間の長い順）
+    static std::vector<ProfileStats> getAllStats();
+
+    /// @brief Chrome trace 形式のJSONを書き出す
+    static void writeChromeTrace(std::ostream& out);
+    static bool writeChromeTrace(const u8string& filePath);
+
+    // ProfileScope から呼ばれる
+    static int64_t beginZone();
+    static void endZone(const char* name, uint32_t hash, int64_t begin);
+
+private:
+    static inline std::atomic<bool> enabled_ = false;
+    static inline std::atomic<bool> componentZones_ = false;
+};
+
+
+/// @brief ProfileScope でコンポーネントの型名のゾーンを作るための印
+struct ProfileComponentTag {};
+
+
+/**
+ * @brief 生存期間をゾーンとして記録するRAIIクラス
+ * 通常は UNIDX_PROFILE_ZONE() などのマクロから使う
+ */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const ProfileZoneId& id)
+    {
+        if (Profiler::isEnabled()) start(id.name, id.hash);
+    }
+
+    /// @brief component の実際の型名のゾーン。Profiler::isComponentZonesEnabled() のときだけ記録する
+    template<typename T>
+    ProfileScope(ProfileComponentTag, const T* component)
+    {
+        if (Profiler::isComponentZonesEnabled())
+        {
+            const char* name = typeid(*component).name();
+            start(name, ProfileZoneId::Hash(name));
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (name_ != nullptr) Profiler::endZone(name_, hash_, begin_);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_ = nullptr; // 記録しないときは nullptr
+    uint32_t hash_ = 0;
+    int64_t begin_ = 0;
+
+    void start(const char* name, uint32_t hash)
+    {
+        name_ = name;
+        hash_ = hash;
+        begin_ = Profiler::beginZone();
+    }
+};
+
+} // namespace UniDx
+
+
+#if UNIDX_PROFILER
+
+#define UNIDX_PROFILE_CONCAT_(a, b) a##b
+#define UNIDX_PROFILE_CONCAT(a, b) UNIDX_PROFILE_CONCAT_(a, b)
+
+/// @brief 現在のスコープを name のゾーンとして記録する
+#define UNIDX_PROFILE_ZONE(name) \
+    static constexpr ::UniDx::ProfileZoneId UNIDX_PROFILE_CONCAT(unidxProfileId_, __LINE__)(name); \
+    ::UniDx::ProfileScope UNIDX_PROFILE_CONCAT(unidxProfileZone_, __LINE__)(UNIDX_PROFILE_CONCAT(unidxProfileId_, __LINE__))
+
+/// @brief 現在のスコープを component の型名のゾーンとして記録する
+#define UNIDX_PROFILE_COMPONENT(component) \
+    ::UniDx::ProfileScope UNIDX_PROFILE_CONCAT(unidxProfileZone_, __LINE__){ ::UniDx::ProfileComponentTag{}, component }
+
+#else
+
+#define UNIDX_PROFILE_ZONE(name)
+#define UNIDX_PROFILE_COMPONENT(component)
+
+#endif
@@ -4,11 +4,16 @@
  * @brief C#のプロパティライクな記述を実現するクラス
  * ReadOnlyProperty<> 読み取り専用プロパティ
  * Property<> 読み書きプロパティ
+ * UNIDX_READONLY_PROPERTY / UNIDX_PROPERTY コンパイル時にアクセサを束縛するメンバプロパティ
  * メンバアクセス(.演算)が使えないなどの制約がある
  */
 #pragma once
 
 #include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include "UniDxDefine.h"
 
 namespace UniDx
@@ -101,4 +106,130 @@ template<typename T>
 inline u8string ToString(const Property<T>& v) { return ToString(v.get()); }
 
 
+// 空のメンバに領域を割り当てないための属性
+#if defined(_MSC_VER)
+#define UNIDX_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define UNIDX_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+
+/**
+ * @brief データメンバポインタが指すメンバの、所有クラスの先頭からのオフセット
+ * offsetof は仮想関数を持つクラス（標準レイアウトでないクラス）では規格上サポートされないため、
+ * MSVC と Itanium C++ ABI（GCC / Clang）でデータメンバポインタがオフセットそのもので表されることを利用する。
+ * 仮想継承を含むクラスでは表現が変わるので使えない（サイズの static_assert で検出する）
+ */
+template<typename Owner, typename M>
+inline size_t MemberOffset(M Owner::* member)
+{
+#if defined(_MSC_VER)
+    using Offset = int32_t;
+#else
+    using Offset = ptrdiff_t;
+#endif
+    static_assert(sizeof(member) == sizeof(Offset), "仮想継承を含むクラスのメンバプロパティは使えない");
+    Offset offset;
+    std::memcpy(&offset, &member, sizeof(offset));
+    return size_t(offset);
+}
+
+
+/**
+ * @brief コンパイル時にアクセサを束縛する読み取り専用プロパティ
+ * インスタンスごとのデータを持たず、所有クラスのアドレスは自身のオフセットから求める。
+ * オフセットはメンバポインタから求めるので、所有クラスは仮想関数を持っていてよいが仮想継承はできない。
+ * 直接使わず UNIDX_READONLY_PROPERTY マクロで宣言する
+ */
+template<typename Owner, typename T, typename Accessor>
+class ReadOnlyMemberProperty
+{
+public:
+    ReadOnlyMemberProperty() = default;
+    ReadOnlyMemberProperty(const ReadOnlyMemberProperty&) {}
+    ReadOnlyMemberProperty& operator=(const ReadOnlyMemberProperty&) { return *this; }
+
+    /** @brief 値の取得*/
+    T get() const { return Accessor::get(owner()); }
+
+    /** @brief 値の変換*/
+    operator T() const { return get(); }
+
+    /** @brief メンバアクセス（ポインタのみ）*/
+    T operator->() const requires std::is_pointer_v<T> { return get(); }
+
+    /** @brief 三方比較演算*/
+    template<typename U> requires (!std::is_pointer_v<T>)
+    auto operator<=>(const U& rhs) const { return get() <=> rhs; }
+
+    // ポインタ比較演算
+    template<typename U> requires std::is_pointer_v<T>
+    bool operator==(U* rhs) const { return get() == rhs; }
+    template<typename U> requires std::is_pointer_v<T>
+    bool operator!=(U* rhs) const { return get() != rhs; }
+
+protected:
+    const Owner& owner() const
+    {
+        return *reinterpret_cast<const Owner*>(reinterpret_cast<const char*>(this) - Accessor::offset());
+    }
+    Owner& owner()
+    {
+        return *reinterpret_cast<Owner*>(reinterpret_cast<char*>(this) - Accessor::offset());
+    }
+};
+
+
+/**
+ * @brief コンパイル時にアクセサを束縛する読み書きプロパティ
+ * 直接使わず UNIDX_PROPERTY マクロで宣言する
+ */
+template<typename Owner, typename T, typename Accessor>
+class MemberProperty : public ReadOnlyMemberProperty<Owner, T, Accessor>
+{
+public:
+    MemberProperty() = default;
+    MemberProperty(const MemberProperty&) {}
+
+    /** @brief 値の設定*/
+    void set(const T& value) { Accessor::set(this->owner(), value); }
+
+    /** @brief C#風代入アクセス*/
+    template<typename U>
+    MemberProperty& operator=(const U& value) { set(T(value)); return *this; }
+    MemberProperty& operator=(const MemberProperty& rhs) { set(rhs.get()); return *this; }
+};
+
+template<typename Owner, typename T, typename Accessor>
+inline u8string ToString(const ReadOnlyMemberProperty<Owner, T, Accessor>& v) { return ToString(v.get()); }
+template<typename Owner, typename T, typename Accessor>
+inline u8string ToString(const MemberProperty<Owner, T, Accessor>& v) { return ToString(v.get()); }
+
+
+/**
+ * @brief クラス定義の中で、コンパイル時に束縛される読み取り専用プロパティを宣言する
+ * getter は所有クラスのメンバ関数名（private でよい、宣言はプロパティより後でもよい）
+ *   例: UNIDX_READONLY_PROPERTY(Transform, Vector3, lossyScale, getLossyScale);
+ */
+#define UNIDX_READONLY_PROPERTY(Owner, T, name, getter) \
+    struct name##Accessor_ { \
+        static T get(const Owner& o) { return o.getter(); } \
+        static size_t offset() { return ::UniDx::MemberOffset(&Owner::name); } \
+    }; \
+    UNIDX_NO_UNIQUE_ADDRESS ::UniDx::ReadOnlyMemberProperty<Owner, T, name##Accessor_> name
+
+/**
+ * @brief クラス定義の中で、コンパイル時に束縛される読み書きプロパティを宣言する
+ * getter / setter は所有クラスのメンバ関数名。setter は const T& を受け取る
+ *   例: UNIDX_PROPERTY(Transform, Vector3, position, getPosition, setPosition);
+ */
+#define UNIDX_PROPERTY(Owner, T, name, getter, setter) \
+    struct name##Accessor_ { \
+        static T get(const Owner& o) { return o.getter(); } \
+        static void set(Owner& o, const T& v) { o.setter(v); } \
+        static size_t offset() { return ::UniDx::MemberOffset(&Owner::name); } \
+    }; \
+    UNIDX_NO_UNIQUE_ADDRESS ::UniDx::MemberProperty<Owner, T, name##Accessor_> name
+
+
 }
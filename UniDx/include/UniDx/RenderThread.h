@@ -0,0 +1,61 @@
+﻿/**
+ * @file RenderThread.h
+ * @brief 抽出済みのフレームを別のスレッドで描画する
+ */
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "UniDxDefine.h"
+#include "FramePacket.h"
+
+namespace UniDx
+{
+
+/**
+ * @brief 抽出済みのフレームを別のスレッドで描画するクラス
+ * メインスレッドは acquire() で空いているパケットを取得して抽出し、submit() で描画を依頼して
+ * すぐに次のフレームのシミュレーションに進む。
+ * パケットは frameLatency 個あり、全て描画待ちなら acquire() は１つ描画し終わるまで待つ。
+ * D3Dのコンテキストを使うのはこのスレッドだけにすること。
+ */
+class RenderThread
+{
+public:
+    /// @param frameLatency 描画がシミュレーションから遅れてよいフレーム数（1 か 2）
+    explicit RenderThread(int frameLatency);
+    ~RenderThread();
+
+    int frameLatency() const { return int(packets_.size()); }
+
+    /// @brief 空いているパケットを取得する。なければ描画が終わるまで待つ
+    FramePacket& acquire();
+
+    /// @brief acquire() したパケットの描画を依頼する
+    void submit(FramePacket& packet);
+
+    /// @brief 依頼したフレームの描画が全て終わるまで待つ
+    void flush();
+
+private:
+    std::vector<std::unique_ptr<FramePacket>> packets_;
+    std::vector<FramePacket*> free_;    // 抽出に使えるパケット
+    std::deque<FramePacket*>  queue_;   // 描画待ちのパケット
+    bool rendering_ = false;            // 描画スレッドがパケットを実行中
+    bool quit_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable submitted_; // 描画スレッドを起こす
+    std::condition_variable released_;  // パケットの描画が終わった
+
+    std::thread thread_;
+
+    void threadMain();
+};
+
+} // namespace UniDx
@@ -19,16 +19,23 @@ namespace UniDx {
 
 class Camera;
 class Material;
+class FramePacket;
 
 
  /// @brief 3D描画を行う基本コンポーネント
 class Renderer : public Component
 {
 public:
+    // 派生型のプールを ComponentPoolGroup<Renderer> にまとめ、描画情報の抽出でメモリの順に走査する
+    using PoolGroup = Renderer;
+
     std::vector< std::shared_ptr<Material> > materials;
     int lightCount = 0;
 
-    virtual void render(const Camera& camera) {}
+    /// @brief 描画に必要な情報をパケットに写す（メインスレッドで後更新の後に呼ばれる）
+    virtual void extract(FramePacket& packet) {}
+
+    virtual ~Renderer();
 
     /** @brief マテリアルを追加（共有） */
     void AddMaterial(std::shared_ptr<Material> material)
@@ -60,12 +67,31 @@ public:
     }
 
 protected:
+    Renderer() = default;
+
+    // 複製用。マテリアルは共有し、定数バッファは有効化したときに作り直す
+    Renderer(const Renderer& source);
+
     ComPtr<ID3D11Buffer> constantBufferPerObject;
+    ComPtr<ID3D11Buffer> constantBufferLightPerObject;
+
+    // 定数バッファに転送したときの世代番号。変わっていなければ転送を省く
+    uint32_t transformVersion_ = 0;
+    uint32_t lightTransformVersion_ = 0;
+    uint32_t lightsVersion_ = 0;
 
     virtual void OnEnable() override;
+    virtual void registerLoop() override;
+    virtual void unregisterLoop() override;
     virtual void createConstantBufferPerObject();
-    virtual void bindPerObject();
-    virtual void bindLightPerObject();
+    virtual void extractPerObject(FramePacket& packet);
+    virtual void extractLightPerObject(FramePacket& packet);
+
+private:
+    uint32_t renderSlot_ = UINT32_MAX; // 描画リスト内の位置（new で作ったもの）
+    bool rendering_ = false;           // 描画対象として登録されている
+
+    friend class PlayerLoop;
 };
 
 /// @brief メッシュ用のレンダラーコンポーネント
@@ -76,8 +102,11 @@ public:
 
     MeshRenderer();
 
-    // メッシュを使って描画
-    virtual void render(const Camera& camera) override;
+    // メッシュとマテリアルの描画をパケットに写す
+    virtual void extract(FramePacket& packet) override;
+
+protected:
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
 };
 
 
@@ -18,10 +18,10 @@ class Rigidbody : public Component
 {
 public:
     // 位置。値を直接設定するとテレポートする。
-    Property<Vector3> position;
+    UNIDX_PROPERTY(Rigidbody, Vector3, position, getPosition, setPosition);
 
     // 向き
-    Property<Quaternion> rotation;
+    UNIDX_PROPERTY(Rigidbody, Quaternion, rotation, getRotation, setRotation);
 
     // 速度
     Vector3 linearVelocity{ 0, 0, 0 };
@@ -34,17 +34,8 @@ public:
 
     bool isKinematic = false;
 
-    Rigidbody() :
-        position(
-            [this]() { return position_; },
-            [this](Vector3 v) { position_ = v; move_ = Vector3::zero; hasMovePos_ = true; }
-        ),
-        rotation(
-            [this]() { return rotation_; },
-            [this](Quaternion q) { rotation_ = q; hasMoveRot_ = true; }
-        )
-    {
-    }
+    // 物理LODの対象にするか（false なら遠くても毎ステップ計算する）
+    bool useSimulationLod = true;
 
     // 初期化
     virtual void Awake() override
@@ -55,12 +46,31 @@ public:
 
     virtual void OnEnable() override
     {
-        Physics::getInstance()->registerRigidbody(this);
+        // 無効の間に Transform が動かされていても（プールから再利用したときなど）そこから始める
+        position_ = transform->position;
+        rotation_ = transform->rotation;
+        move_ = Vector3::zero;
+        hasMovePos_ = false;
+        hasMoveRot_ = false;
+        getPhysicsWorld()->registerRigidbody(this);
     }
 
     virtual void OnDisable() override
     {
-        Physics::getInstance()->unregisterRigidbody(this);
+        getPhysicsWorld()->unregisterRigidbody(this);
+    }
+
+    // 登録先の物理ワールドを取得（未指定ならデフォルトの Physics）
+    PhysicsWorld* getPhysicsWorld() const { return physicsWorld_ != nullptr ? physicsWorld_ : Physics::getInstance(); }
+
+    // 登録先の物理ワールドを変更。ワールドを指定していない Collider も一緒に移す
+    void setPhysicsWorld(PhysicsWorld* world)
+    {
+        PhysicsWorld* old = getPhysicsWorld();
+        if (enabled) old->unregisterRigidbody(this);
+        physicsWorld_ = world;
+        if (enabled) getPhysicsWorld()->registerRigidbody(this);
+        old->updateColliderWorlds(this);
     }
 
     // 指定位置に移動。補間が有効な場合は間の衝突判定を行う。
@@ -83,14 +93,15 @@ public:
 
     // 衝突前の物理更新
     // ここで移動量などを設定しておくが、位置や速度の更新はコリジョン処理の後
-    virtual void physicsUpdate()
+    // step は物理LODによって fixedDeltaTime の倍数になる
+    virtual void physicsUpdate(float step)
     {
         if (!enabled) return;
 
         // 重力適用
         if (gravityScale != 0.0f)
         {
-            linearVelocity.y += Physics::gravity * gravityScale * Time::fixedDeltaTime;
+            linearVelocity.y += getPhysicsWorld()->gravity * gravityScale * step;
         }
 
         // 位置の直接指定がなければ、移動ベクトルに速度を入れる
@@ -125,13 +136,23 @@ public:
         transform->rotation = rotation_;
     }
 
+protected:
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
+
 private:
+    PhysicsWorld* physicsWorld_ = nullptr;
     Vector3 position_;
     Quaternion rotation_;
     Vector3 move_{ 0, 0, 0 };
 
     bool hasMovePos_ = false;
     bool hasMoveRot_ = false;
+
+    // プロパティのアクセサ
+    Vector3 getPosition() const { return position_; }
+    void setPosition(const Vector3& v) { position_ = v; move_ = Vector3::zero; hasMovePos_ = true; }
+    Quaternion getRotation() const { return rotation_; }
+    void setRotation(const Quaternion& q) { rotation_ = q; hasMoveRot_ = true; }
 };
 
 
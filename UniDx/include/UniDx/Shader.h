@@ -79,7 +79,7 @@ struct ShaderVarLayout
 class Shader : public Object
 {
 public:
-	Shader() : Object([this]() {return fileName;}) {}
+	Shader() {}
 
 	bool compile(const u8string& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size);
 
@@ -97,6 +97,8 @@ public:
 protected:
 	StringId fileName;
 
+	virtual StringId getName() const override { return fileName; }
+
 	// ピクセルシェーダーから変数のレイアウトを反映
 	void reflectPSLayout(ID3DBlob* psBlob);
 
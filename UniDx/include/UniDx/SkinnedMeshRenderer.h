@@ -69,11 +69,19 @@ public:
     SkinInstance* skin = nullptr;
     SkinnedMeshRenderer();
 
+    // 複製用。スキンは resolveClone() で複製先のものに置き換える
+    SkinnedMeshRenderer(const SkinnedMeshRenderer& source) : MeshRenderer(source), skin(source.skin) {}
+
 protected:
     virtual void createConstantBufferPerObject() override;
-    virtual void bindPerObject() override;
+    virtual void extractPerObject(FramePacket& packet) override;
+    virtual ComponentPtr<Component> clone(CloneMap& map) const override { return CloneComponent(*this); }
+    virtual void resolveClone(const CloneMap& map) override;
 
     unique_ptr<ConstantBufferSkinPerObject> constantBuffer;
+
+    // ボーン行列を計算したときのジョイントの世代番号
+    std::vector<uint32_t> jointVersions_;
 };
 
 
@@ -24,10 +24,10 @@ public:
 	const std::wstring& getU16Text() const { return u16text; }
 
 	virtual void Awake() override;
-	virtual void render(const Matrix4x4& proj) const;
+	virtual void extract(FramePacket& packet, const Matrix4x4& proj) const override;
 
 private:
-	unique_ptr<DirectX::SpriteBatch> spriteBatch;
+	shared_ptr<DirectX::SpriteBatch> spriteBatch; // 描画スレッドと共有
 	std::wstring     u16text;
 };
 
@@ -20,7 +20,7 @@ public:
     D3D11_TEXTURE_ADDRESS_MODE wrapModeU;
     D3D11_TEXTURE_ADDRESS_MODE wrapModeV;
 
-    Texture() : Object([this]() {return fileName; }),
+    Texture() :
         wrapModeU(D3D11_TEXTURE_ADDRESS_CLAMP),
         wrapModeV(D3D11_TEXTURE_ADDRESS_CLAMP),
         m_info()
@@ -44,6 +44,8 @@ protected:
     ComPtr<ID3D11SamplerState> samplerState;
     StringId fileName;
 
+    virtual StringId getName() const override { return fileName; }
+
     // シェーダーリソースビュー(画像データ読み取りハンドル)
     ComPtr<ID3D11ShaderResourceView> m_srv = nullptr;
 
@@ -9,6 +9,7 @@
 #include "UniDxDefine.h"
 #include "Component.h"
 #include "GameObject.h"
+#include "TransformHierarchy.h"
 
 
 namespace UniDx {
@@ -17,6 +18,7 @@ namespace UniDx {
 /**
  * @brief GameObjectの位置、回転、スケールを扱い、階層構造を実現するクラス
  * GameObjectに必ず１つアタッチされている
+ * 姿勢と行列の実体は TransformHierarchy の配列にあり、Transformはそのインデックスを持つ
  */
 class Transform : public Component
 {
@@ -24,19 +26,24 @@ public:
     typedef std::vector<unique_ptr<GameObject>> GameObjectContainer;
 
     // ローカルの姿勢
-    Property<Vector3> localPosition;
-    Property<Quaternion> localRotation;
-    Property<Vector3> localScale;
+    UNIDX_PROPERTY(Transform, Vector3, localPosition, getLocalPosition, setLocalPosition);
+    UNIDX_PROPERTY(Transform, Quaternion, localRotation, getLocalRotation, setLocalRotation);
+    UNIDX_PROPERTY(Transform, Vector3, localScale, getLocalScale, setLocalScale);
 
     // ワールド空間のプロパティ
-    Property<Vector3> position;
-    Property<Quaternion> rotation;
-    Property<Vector3> forward;
-    Property<Vector3> up;
-    Property<Vector3> right;
+    UNIDX_PROPERTY(Transform, Vector3, position, getPosition, setPosition);
+    UNIDX_PROPERTY(Transform, Quaternion, rotation, getRotation, setRotation);
+    UNIDX_PROPERTY(Transform, Vector3, forward, getForward, setForward);
+    UNIDX_PROPERTY(Transform, Vector3, up, getUp, setUp);
+    UNIDX_PROPERTY(Transform, Vector3, right, getRight, setRight);
+    UNIDX_READONLY_PROPERTY(Transform, Vector3, lossyScale, getLossyScale);
 
     Transform* parent = nullptr;
 
+    /// @brief 子を外したときに残りの子の順序を保つか
+    /// false のときは末尾の子を空いた位置に移して O(1) で外す。true のときは子の数に比例する
+    bool keepChildOrder = false;
+
     const GameObjectContainer& getChildGameObjects() const { return children; }
 
     /// @brief 親の変更（すでに親を設定している場合）
@@ -51,13 +58,43 @@ public:
     /// @brief 子を取得
     Transform* GetChild(size_t index) const;
 
+    /// @brief 親の子の中での位置
+    size_t GetSiblingIndex() const { return siblingIndex_; }
+
+    /// @brief 並べ替えをまたいで保持できるハンドル。破棄されるか Prefab のプールに戻されると無効になる
+    TransformHandle getHandle() const { return hierarchy().handleOf(index_); }
+
+    /// @brief 動かないTransformか
+    bool isStatic() const { return hierarchy().static_[index_] != 0; }
+
+    /// @brief 動かないTransformにする
+    /// 静的なTransformのワールド行列は一度だけ計算され、以降は毎フレームの更新や物理の再計算から外れる。
+    /// 計算後に姿勢を変更するとデバッグビルドではassertする。親も動かさないこと
+    void setStatic(bool value) { hierarchy().setStatic(index_, value); }
+
     /// @brief ローカル座標系から親座標系への変換行列
     const Matrix4x4& localMatrix() const;
 
     /// @brief ワールド座標系への変換行列
     const Matrix4x4& localToWorldMatrix() const {
         updateMatrices();
-        return m_worldMatrix;
+        return hierarchy().worldMatrices_[index_];
+    }
+
+    /// @brief ワールド行列の世代番号
+    /// ワールド行列が再計算されるたびに増える。0 は未計算を表すので、保存側の初期値に使える
+    uint32_t getVersion() const {
+        updateMatrices();
+        return hierarchy().versions_[index_];
+    }
+
+    /// @brief 指定した世代番号のあとにワールド行列が変わったか
+    bool hasChangedSince(uint32_t version) const { return getVersion() != version; }
+
+    /// @brief ワールド座標系からローカル座標系への変換行列
+    const Matrix4x4& worldToLocalMatrix() const {
+        updateMatrices();
+        return hierarchy().inverseWorldMatrix(index_);
     }
 
     Transform();
@@ -79,23 +116,67 @@ public:
     }
 
 private:
-    // ダーティフラグと行列
-    mutable bool m_dirty = true;
-    mutable Matrix4x4 m_localMatrix = Matrix4x4::identity;
-    mutable Matrix4x4 m_worldMatrix = Matrix4x4::identity;
-
-    bool dirtyInHierarchy() const { return m_dirty || parent && parent->dirtyInHierarchy(); }
+    // TransformHierarchy 内のインデックス
+    uint32_t index_ = TransformHierarchy::InvalidIndex;
 
-    Vector3 _localPosition{ 0,0,0 };
-    Quaternion _localRotation = Quaternion::identity;
-    Vector3 _localScale{ 1,1,1 };
+    // 親の children 内の位置
+    uint32_t siblingIndex_ = 0;
 
     // 子GameObject
     // トップ以外のGameObjectはTransformによって保持される
     GameObjectContainer children;
 
+    // 子を末尾に追加
+    void addChild(unique_ptr<GameObject> child);
+
+    // 子を外して所有権を返す
+    unique_ptr<GameObject> removeChild(Transform* child);
+
+    TransformHierarchy& hierarchy() const { return *TransformHierarchy::getInstance(); }
+
+    // ローカル姿勢の変更を記録
+    void markDirty() {
+        assert(!hierarchy().isBaked(index_)); // 静的なTransformは動かせない
+        hierarchy().dirty_[index_] = 1;
+    }
+
+    // キャッシュ済みのワールド回転
+    const Quaternion& worldRotation() const {
+        updateMatrices();
+        return hierarchy().worldRotations_[index_];
+    }
+
+    // プロパティのアクセサ
+    Vector3 getLocalPosition() const { return hierarchy().localPositions_[index_]; }
+    void setLocalPosition(const Vector3& v) { hierarchy().localPositions_[index_] = v; markDirty(); }
+    Quaternion getLocalRotation() const { return hierarchy().localRotations_[index_]; }
+    void setLocalRotation(const Quaternion& q) { hierarchy().localRotations_[index_] = q; markDirty(); }
+    Vector3 getLocalScale() const { return hierarchy().localScales_[index_]; }
+    void setLocalScale(const Vector3& v) { hierarchy().localScales_[index_] = v; markDirty(); }
+
+    Vector3 getPosition() const { return localToWorldMatrix().translation(); }
+    void setPosition(const Vector3& worldPos);
+    Quaternion getRotation() const { return worldRotation(); } // 行列の更新時に親の回転と合成済み
+    void setRotation(const Quaternion& worldRot);
+    Vector3 getForward() const { return Vector3::forward * worldRotation(); }
+    void setForward(const Vector3& worldForward);
+    Vector3 getUp() const { return Vector3::up * worldRotation(); }
+    void setUp(const Vector3& worldUp);
+    Vector3 getRight() const { return Vector3::right * worldRotation(); }
+    void setRight(const Vector3& worldRight);
+    Vector3 getLossyScale() const { updateMatrices(); return hierarchy().lossyScales_[index_]; } // 親のスケールを掛け合わせたおおよそのワールドスケール
+
     // 行列の更新
     void updateMatrices() const;
+
+    friend class TransformHierarchy;
+    friend class TransformAccessArray;
+    friend class HierarchyBuilder;
+    friend class Prefab;
 };
 
+
+// Component::transform の取得（Transformの定義が必要なためここで定義）
+inline Transform* Component::getTransform() const { return gameObject->transform; }
+
 } // namespace UniDx
@@ -0,0 +1,111 @@
+﻿/**
+ * @file TransformAccessArray.h
+ * @brief 多数のTransformのローカル姿勢をまとめて並列に更新する
+ */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "UniDxDefine.h"
+#include "Math.h"
+#include "JobSystem.h"
+#include "TransformHierarchy.h"
+
+namespace UniDx
+{
+
+class Transform;
+
+/**
+ * @brief カーネルから見た１つのTransformのローカル姿勢
+ * TransformHierarchy の配列を直接指している
+ */
+struct TransformAccess
+{
+    Vector3& localPosition;
+    Quaternion& localRotation;
+    Vector3& localScale;
+};
+
+
+/**
+ * @brief Transformの集合のローカル姿勢を一括で処理するクラス
+ * Transformはハンドルで保持し、ForEach() はその TransformHierarchy 上のインデックスを引いて
+ * 配列の要素を直接カーネルに渡し、複数スレッドで並列に呼び出す。コピーや書き戻しはしない。
+ * 破棄されたか Prefab のプールに戻されたTransformの要素は無効になって飛ばされる（isValid() が false になる）。
+ * カーネルの中では他のTransformや GameObject にアクセスしないこと。同じTransformを２回追加しないこと。
+ *
+ * @code
+ * coins.ForEach([speed, dt](size_t i, TransformAccess& t) {
+ *     t.localRotation = Quaternion::AngleAxis(speed * dt, Vector3::up) * t.localRotation;
+ * });
+ * @endcode
+ */
+class TransformAccessArray
+{
+public:
+    /// @brief 並列処理の1タスクにまとめるTransformの数の目安
+    size_t parallelGrain = 256;
+
+    TransformAccessArray() = default;
+    explicit TransformAccessArray(size_t capacity) { reserve(capacity); }
+
+    /// @brief Transformを追加
+    void Add(Transform* transform);
+
+    /// @brief Transformを探して、末尾と入れ替えて削除。見つからなければ false
+    bool Remove(Transform* transform);
+
+    /// @brief 指定したインデックスのTransformを末尾と入れ替えて削除
+    void RemoveAtSwapBack(size_t index)
+    {
+        handles_[index] = handles_.back();
+        handles_.pop_back();
+    }
+
+    /// @brief すべて削除
+    void clear() { handles_.clear(); }
+
+    void reserve(size_t capacity) { handles_.reserve(capacity); }
+
+    size_t length() const { return handles_.size(); }
+
+    /// @brief 指定したインデックスのTransformがまだ破棄されていないか
+    bool isValid(size_t index) const { return TransformHierarchy::getInstance()->indexOf(handles_[index]) != TransformHierarchy::InvalidIndex; }
+
+    /// @brief 指定したインデックスのTransform。破棄されていれば nullptr
+    Transform* operator[](size_t index) const;
+
+    /**
+     * @brief 破棄されていないすべてのTransformのローカル姿勢に対してカーネルを並列に実行する
+     * @param kernel void(size_t index, TransformAccess& transform)
+     */
+    template<typename Kernel>
+    void ForEach(Kernel&& kernel)
+    {
+        TransformHierarchy& h = *TransformHierarchy::getInstance();
+
+        // parallelGrain ごとの区間に分けて並列に実行
+        // 要素ごとに別のTransformなので、ダーティの印もそのまま付けてよい
+        JobSystem::parallelFor(handles_.size(), parallelGrain,
+            [this, &h, &kernel](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    const uint32_t index = h.indexOf(handles_[i]);
+                    if (index == TransformHierarchy::InvalidIndex) continue;
+                    assert(!h.isBaked(index)); // 静的なTransformは動かせない
+
+                    TransformAccess access{ h.localPositions_[index], h.localRotations_[index], h.localScales_[index] };
+                    kernel(i, access);
+                    h.dirty_[index] = 1;
+                }
+            });
+    }
+
+private:
+    std::vector<TransformHandle> handles_;
+};
+
+} // namespace UniDx
@@ -0,0 +1,156 @@
+﻿/**
+ * @file TransformHierarchy.h
+ * @brief 全Transformの姿勢と行列を親→子順の連続配列で保持し、ワールド行列を一括更新する
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Math.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+class Transform;
+
+/**
+ * @brief 並べ替えや移動でインデックスが変わっても同じTransformを指すハンドル
+ * Transformが破棄されると世代番号が合わなくなり、無効になる
+ */
+struct TransformHandle
+{
+    uint32_t id = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+/**
+ * @brief Transformのデータを構造体配列（SoA）で保持するクラス
+ * 配列は親が必ず子より前に並ぶよう整列され、update() の１回の線形走査で
+ * ダーティなワールド行列をまとめて再計算する。
+ * ワールド行列を計算するたびにそのTransformの世代番号を進め、
+ * 子は計算に使った親の世代番号と比べることで親の変更を検出する。
+ * 十分に大きな部分木は独立した区間として複数スレッドで並列に更新する。
+ * 静的（static）なTransformは一度計算したら親の変更も見ず、
+ * 全体が静的な部分木は並べ替え後の最初の update() で一度だけ計算して以降は走査しない。
+ * 生成や親の変更のたびに全体を並べ替えることはせず、新しいTransformと親が変わった部分木は
+ * 配列の末尾に移して逐次に更新し、削除や移動で空いた位置は穴として残す。
+ * 末尾に移したものと穴の数が一定を超えたときにだけ全体を並べ替えて区間を作り直す。
+ * Transform はこの配列へのインデックスだけを持つ（並べ替えと部分木の移動で変わる）。
+ */
+class TransformHierarchy : public Singleton<TransformHierarchy>
+{
+public:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    /// @brief 並列更新の1タスクにまとめるTransformの数の目安
+    uint32_t parallelGrain = 256;
+
+    /// @brief 全体を並べ替えずにおく、末尾に移したTransformと穴の数の上限（並べ替え済みの数の1/4 とのうち大きい方）
+    uint32_t reorderThreshold = 1024;
+
+    /// @brief 階層の並び替えと、ダーティなワールド行列の一括更新
+    void update();
+
+    /// @brief 登録されているTransformの数
+    size_t size() const { return owners_.size() - holeCount_; }
+
+    /// @brief index にあるTransformのハンドル
+    TransformHandle handleOf(uint32_t index) const { return { ids_[index], idGenerations_[ids_[index]] }; }
+
+    /// @brief ハンドルが指すTransformの現在のインデックス。破棄されていれば InvalidIndex
+    uint32_t indexOf(TransformHandle handle) const
+    {
+        return handle.id < idToIndex_.size() && idGenerations_[handle.id] == handle.generation ? idToIndex_[handle.id] : InvalidIndex;
+    }
+
+    /// @brief ハンドルが指すTransform。破棄されていれば nullptr
+    Transform* find(TransformHandle handle) const
+    {
+        const uint32_t index = indexOf(handle);
+        return index != InvalidIndex ? owners_[index] : nullptr;
+    }
+
+private:
+    // 並列に更新できる区間 [begin, end)
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // Transformごとのデータ（インデックスで対応）
+    std::vector<Transform*> owners_;
+    std::vector<uint32_t> parents_;
+    std::vector<Vector3> localPositions_;
+    std::vector<Quaternion> localRotations_;
+    std::vector<Vector3> localScales_;
+    std::vector<Matrix4x4> localMatrices_;
+    std::vector<Matrix4x4> worldMatrices_;
+    std::vector<Quaternion> worldRotations_;
+    std::vector<Vector3> lossyScales_;
+    std::vector<Matrix4x4> inverseWorldMatrices_;  // 必要になったときに計算
+    std::vector<uint8_t> inverseValid_;
+    std::vector<uint8_t> dirty_;            // ローカル姿勢が変更された
+    std::vector<uint8_t> static_;           // 動かないTransform
+    std::vector<uint32_t> versions_;        // ワールド行列の世代番号（0 は未計算）
+    std::vector<uint32_t> parentVersions_;  // 計算に使った親の世代番号
+    std::vector<uint32_t> subtreeSizes_;
+    std::vector<uint8_t> staticSubtrees_;   // 部分木全体が静的（並べ替えのたびに作り直す）
+    std::vector<uint32_t> ids_;             // ハンドルのID
+
+    // ハンドルのIDごとのデータ
+    std::vector<uint32_t> idToIndex_;
+    std::vector<uint32_t> idGenerations_;   // Transformが破棄されるたびに進める
+    std::vector<uint32_t> freeIds_;
+
+    uint32_t orderedCount_ = 0;             // 先頭から並べ替え済みの数。以降は末尾に追加・移動したもの
+    uint32_t holeCount_ = 0;                // 削除や移動で空いた位置の数
+    bool orderDirty_ = false;               // 次の update() で必ず並べ替える
+    std::vector<uint32_t> stack_;           // 部分木をたどる作業用
+
+    // update() の分割（並べ替えのたびに作り直す）
+    std::vector<uint32_t> serialIndices_;   // 大きな部分木の根。逐次に更新する
+    std::vector<Range> parallelRanges_;     // 互いに独立した部分木の区間
+    std::vector<Range> staticRanges_;       // 静的な部分木の区間。一度計算したら空にする
+
+    uint32_t allocate(Transform* owner);
+    void release(uint32_t index);
+    void setParent(uint32_t index, uint32_t parentIndex);
+    void setStatic(uint32_t index, bool value);
+
+    // index のTransformを指すこれまでのハンドルを無効にする（IDはそのまま、世代だけ進める）
+    void renewHandle(uint32_t index) { ++idGenerations_[ids_[index]]; }
+
+    uint32_t appendSlot();
+    void moveSubtreeToEnd(uint32_t index, uint32_t parentIndex);
+    void rebuildOrder();
+    void buildRanges();
+    void updateRange(uint32_t begin, uint32_t end);
+
+    // ローカル姿勢か親のワールド行列が変わっていて、再計算が必要か
+    // 静的なTransformは親の変更を見ない（親も動かさないこと）
+    bool needsUpdate(uint32_t index) const
+    {
+        const uint32_t p = parents_[index];
+        return dirty_[index] || (!static_[index] && p != InvalidIndex && parentVersions_[index] != versions_[p]);
+    }
+
+    // 計算済みの静的なTransformか
+    bool isBaked(uint32_t index) const { return static_[index] && versions_[index] != 0 && !dirty_[index]; }
+
+    // 1つのTransformのローカル行列とワールド行列、ワールド回転とスケールを計算
+    void computeMatrices(uint32_t index);
+
+    // 逆ワールド行列を取得（ワールド行列の更新後、最初の呼び出しで計算）
+    const Matrix4x4& inverseWorldMatrix(uint32_t index);
+
+    friend class Transform;
+    friend class TransformAccessArray;
+    friend class HierarchyBuilder;
+    friend class Prefab;
+};
+
+} // namespace UniDx
@@ -5,6 +5,7 @@
 namespace UniDx {
 
 class Canvas;
+class FramePacket;
 
 // --------------------
 // UIBehaviour基底クラス
@@ -14,7 +15,7 @@ class UIBehaviour : public Behaviour
 public:
 	virtual void OnEnable() override;
 	virtual void OnDisable() override;
-	virtual void render(const Matrix4x4& proj) const {}
+	virtual void extract(FramePacket& packet, const Matrix4x4& proj) const {}
 
 protected:
 	Canvas* owner = nullptr;
@@ -8,6 +8,8 @@
 
 #include "GameObject.h"
 #include "Transform.h"
+#include "TransformAccessArray.h"
+#include "HierarchyBuilder.h"
 #include "GameObject_impl.h"
 #include "Random.h"
 #include "Behaviour.h"
@@ -15,4 +17,7 @@
 #include "Collider.h"
 #include "Camera.h"
 #include "Light.h"
+#include "Prefab.h"
+#include "Coroutine.h"
+#include "Profiler.h"
 
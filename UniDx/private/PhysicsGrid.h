@@ -22,7 +22,7 @@ class PhysicsGrid
 {
 public:
     typedef std::pair<PhysicsShape*, PhysicsShape*> PotentialPair;
-    typedef MemberAction<Physics, PhysicsShape*, PhysicsShape*> CheckBoundFunc;
+    typedef MemberAction<PhysicsWorld, PhysicsShape*, PhysicsShape*> CheckBoundFunc;
 
     PhysicsGrid(CheckBoundFunc checkBoundFunc);
 
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <array>
+
+
+namespace UniDx
+{
+
+// --------------------
+// PhysicsGridTuner
+// --------------------
+/**
+ * @brief ブロードフェーズのパラメータを実行中に調整する
+ * 一定ステップ数の窓でブロードフェーズと詳細判定の処理時間を計測し、
+ * 近傍のパラメータを試して速くなった場合だけ採用する（山登り法）。
+ * 近傍を試す順は1周の間固定し、不採用のときは基準を測り直さずに次の近傍を試す。
+ * 採用したときはその計測を新しい基準にして次の周を始める
+ */
+class PhysicsGridTuner
+{
+public:
+    typedef PhysicsWorld::BroadphaseSettings Params;
+
+    // 調整する範囲
+    static constexpr int NodeDivideMin = 2;
+    static constexpr int NodeDivideMax = 16;
+    static constexpr int MaxPerCellMin = 4;
+    static constexpr int MaxPerCellMax = 64;
+    static constexpr size_t BruteForceShapeMax = 128; // 総当たりを試すShape数の上限
+
+    int windowSize = 60;            // 1回の計測に使うステップ数
+    float acceptRatio = 0.95f;      // 試したパラメータの処理時間がこの割合より短ければ採用
+
+    /**
+     * @brief 1ステップ分の計測結果を追加
+     * @param params 現在のパラメータ。変更するときは書き換える
+     * @return パラメータを変更したとき true
+     */
+    bool addSample(double milliseconds, size_t candidatePairs, size_t contactPairs, size_t shapeCount, Params& params);
+
+    // 調整が収束しているか
+    bool isSettled() const { return phase_ == Phase::Settled; }
+
+    // 計測をやり直す
+    void reset();
+
+private:
+    enum class Phase
+    {
+        Baseline,   // 現在のパラメータを計測中
+        Trial,      // 近傍のパラメータを計測中
+        Settled,    // どの近傍も速くならなかった
+    };
+
+    Phase phase_ = Phase::Baseline;
+    int count_ = 0;
+    double totalTime_ = 0.0;
+    size_t totalCandidates_ = 0;
+    size_t totalContacts_ = 0;
+    size_t shapeCount_ = 0;         // 計測開始時のShape数
+
+    double baselineCost_ = 0.0;
+    Params baselineParams_{};
+
+    // この周で試す近傍（周の始めに決めて、周の間は並びを変えない）
+    static constexpr int CandidateMax = 5;
+    std::array<Params, CandidateMax> candidates_{};
+    int candidateCount_ = 0;
+    int candidateIndex_ = 0;        // 次に試す近傍の番号
+
+    bool beginRound(double ratio, Params& params);
+    bool tryNextCandidate(Params& params);
+    int buildCandidates(const Params& current, double ratio, std::array<Params, CandidateMax>& out) const;
+    void clearWindow();
+};
+
+}
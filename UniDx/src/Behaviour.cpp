@@ -0,0 +1,126 @@
+﻿#include "pch.h"
+#include <UniDx/Behaviour.h>
+
+#include <UniDx/PlayerLoop.h>
+#include <UniDx/CommandBuffer.h>
+
+namespace UniDx
+{
+
+// デストラクタ
+// 有効なまま破棄されたときも実行リストに残さない
+Behaviour::~Behaviour()
+{
+    unregisterLoop();
+}
+
+
+// オーバーライドされていなければ、以降は呼び出さないよう実行リストから外す
+void Behaviour::FixedUpdate()
+{
+    loopFlags_ &= ~BehaviourLoop_FixedUpdate;
+    registerLoop();
+}
+
+
+void Behaviour::Update()
+{
+    loopFlags_ &= ~BehaviourLoop_Update;
+    registerLoop();
+}
+
+
+void Behaviour::LateUpdate()
+{
+    loopFlags_ &= ~BehaviourLoop_LateUpdate;
+    registerLoop();
+}
+
+
+// 物理のコールバックも同様に、オーバーライドされていなければ以降は通知しない
+void Behaviour::OnTriggerEnter(Collider* other) { removePhysicsCallback(PhysicsCallback_TriggerEnter); }
+void Behaviour::OnTriggerStay(Collider* other) { removePhysicsCallback(PhysicsCallback_TriggerStay); }
+void Behaviour::OnTriggerExit(Collider* other) { removePhysicsCallback(PhysicsCallback_TriggerExit); }
+void Behaviour::OnCollisionEnter(const Collision& collision) { removePhysicsCallback(PhysicsCallback_CollisionEnter); }
+void Behaviour::OnCollisionStay(const Collision& collision) { removePhysicsCallback(PhysicsCallback_CollisionStay); }
+void Behaviour::OnCollisionExit(const Collision& collision) { removePhysicsCallback(PhysicsCallback_CollisionExit); }
+
+
+void Behaviour::removePhysicsCallback(PhysicsCallback callback)
+{
+    physicsCallbacks_ &= ~callback;
+
+    // どれもオーバーライドしていなければ通知先から外す
+    if (physicsCallbacks_ == 0 && gameObject != nullptr)
+    {
+        gameObject->invalidatePhysicsListeners();
+    }
+}
+
+
+// ParallelUpdate() を呼び出すかを設定
+void Behaviour::setParallelUpdate(bool value)
+{
+    if (value) loopFlags_ |= BehaviourLoop_ParallelUpdate;
+    else loopFlags_ &= ~BehaviourLoop_ParallelUpdate;
+
+    // 有効なら実行リストを合わせる
+    if (enabled) registerLoop();
+}
+
+
+// コルーチンを開始する
+// 無効なものは停止する機会がないので開始しない
+CoroutineHandle Behaviour::StartCoroutine(Coroutine routine)
+{
+    assert(CommandBuffer::current() == nullptr); // 並列更新中は開始できない
+
+    auto scheduler = CoroutineScheduler::getInstance();
+    if (scheduler == nullptr || !_enabled) return CoroutineHandle();
+
+    return scheduler->start(this, std::move(routine));
+}
+
+
+void Behaviour::StopCoroutine(CoroutineHandle handle)
+{
+    if (auto scheduler = CoroutineScheduler::getInstance())
+    {
+        scheduler->stop(handle);
+    }
+}
+
+
+void Behaviour::StopAllCoroutines()
+{
+    if (coroutineSlot_ == UINT32_MAX) return;
+
+    if (auto scheduler = CoroutineScheduler::getInstance())
+    {
+        scheduler->stopAll(this);
+    }
+}
+
+
+// 実行リストへの登録
+void Behaviour::registerLoop()
+{
+    if (auto loop = PlayerLoop::getInstance())
+    {
+        loop->registerBehaviour(this, !isCalledStart);
+    }
+}
+
+
+// 無効になったときや破棄されるときに呼ばれるので、コルーチンもここで停止する
+void Behaviour::unregisterLoop()
+{
+    StopAllCoroutines();
+
+    if (auto loop = PlayerLoop::getInstance())
+    {
+        loop->unregisterBehaviour(this);
+    }
+}
+
+}
@@ -2,6 +2,7 @@
 #include <UniDx/Camera.h>
 #include <UniDx/ConstantBuffer.h>
 #include <UniDx/D3DManager.h>
+#include <UniDx/FramePacket.h>
 #include <SimpleMath.h>
 
 
@@ -32,13 +33,14 @@ Matrix4x4 Camera::GetProjectionMatrix(float aspect) const
 }
 
 
-void Camera::UpdateConstantBuffer()
+// カメラと時間の定数をパケットに写す
+void Camera::extract(FramePacket& packet) const
 {
     // 時間に関わる time, unscaledDeltaTime, 1/unscaledDeltaTime, frameCount を送信
     constexpr float minDt = 1.0f / 600.0f;
     float dt = std::max(Time::unscaledDeltaTime, minDt);
 
-    ConstantBufferPerCamera cb{};
+    ConstantBufferPerCamera& cb = packet.camera;
     cb.view = GetViewMatrix();
     cb.projection = GetProjectionMatrix(16.0f / 9.0f);
     cb.cameraPosW = transform->position;
@@ -49,12 +51,9 @@ void Camera::UpdateConstantBuffer()
     cb.time.y = dt;
     cb.time.z = 1.0f / dt;
     cb.time.w = float(Time::frameCount);
-    D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferPerCamera.Get(), 0, nullptr, &cb, 0, 0);
 
-    // 定数バッファ更新
-    ID3D11Buffer* cbs[1] = { constantBufferPerCamera.Get() };
-    D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(CB_PerCamera, 1, cbs);
-    D3DManager::getInstance()->GetContext()->PSSetConstantBuffers(CB_PerCamera, 1, cbs);
+    packet.cameraBuffer = constantBufferPerCamera;
+    packet.hasCamera = true;
 }
 
 
@@ -71,7 +70,10 @@ void Camera::OnEnable()
     desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     desc.CPUAccessFlags = 0;
     desc.Usage = D3D11_USAGE_DEFAULT;
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBufferPerCamera.GetAddressOf());
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBuffer(&desc, nullptr, constantBufferPerCamera.GetAddressOf());
+    }
 }
 
 
@@ -24,9 +24,9 @@ void Canvas::Awake()
 void Canvas::LoadDefaultMaterial(const char8_t* assetPath)
 {
 	std::filesystem::path assetRoot = assetPath;
-	defaultMaterial = std::make_unique<Material>();
+	defaultMaterial = std::make_shared<Material>();
 	defaultMaterial->shader->compile<VertexPC>( (assetRoot / "Color.hlsl").u8string());
-	defaultTextureMaterial = std::make_unique<Material>();
+	defaultTextureMaterial = std::make_shared<Material>();
 	defaultTextureMaterial->shader->compile<VertexPTC>((assetRoot / "Sprite.hlsl").u8string());
 }
 
@@ -58,25 +58,14 @@ void Canvas::unregisterUI(UIBehaviour* e)
 }
 
 
-Material* Canvas::getDefaultMaterial()
-{
-	return defaultMaterial.get();
-}
-
-
-Material* Canvas::getDefaultTextureMaterial()
-{
-	return defaultTextureMaterial.get();
-}
-
-
-void Canvas::render() const
+// UIの描画をパケットに写す
+void Canvas::extract(FramePacket& packet) const
 {
 	Matrix4x4 proj( XMMatrixOrthographicLH(size.x, size.y, -1.0f, 1.0f) );
 
 	for (auto& it : elements_)
 	{
-		it->render(proj);
+		it->extract(packet, proj);
 	}
 }
 
@@ -36,7 +36,8 @@ namespace
     }
 
     // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-    bool checkIntersect_(SphereCollider* sphere, AABBCollider* aabb, PhysicsActor* sphereActor, PhysicsActor* aabbActor)
+    // sphereCollision には球側から見た衝突情報を入れる
+    bool checkIntersect_(SphereCollider* sphere, AABBCollider* aabb, PhysicsActor* sphereActor, PhysicsActor* aabbActor, Collision* sphereCollision)
     {
         // 球の中心（ワールド座標）
         Vector3 sphereCenter = sphere->transform->TransformPoint(sphere->center);
@@ -77,8 +78,9 @@ namespace
         float penetration = sphereRadius - dist;
 
         // 質量取得（0以下は1.0f扱い）
-        float massA = (rbA && !rbA->isKinematic) ? (rbA->mass > 0.0f ? rbA->mass : 1.0f) : infinity;
-        float massB = (rbB && !rbB->isKinematic) ? (rbB->mass > 0.0f ? rbB->mass : 1.0f) : infinity;
+        // 物理LODでこのステップに計算しないものは動かないものとして扱う
+        float massA = (rbA && !rbA->isKinematic && sphereActor->isSimulating()) ? (rbA->mass > 0.0f ? rbA->mass : 1.0f) : infinity;
+        float massB = (rbB && !rbB->isKinematic && aabbActor->isSimulating()) ? (rbB->mass > 0.0f ? rbB->mass : 1.0f) : infinity;
         float totalMass = massA + massB;
 
         float massAPerTotal = massA != infinity ? massA / totalMass : 1;
@@ -104,6 +106,11 @@ namespace
         if (rbA && !rbA->isKinematic && massA != infinity) sphereActor->addCorrectVelocity(impulse * massBPerTotal);
         if (rbB && !rbB->isKinematic && massB != infinity) aabbActor->addCorrectVelocity(-impulse * massAPerTotal);
 
+        // 接触点はAABB上の最近点、法線はAABBから球への向き
+        sphereCollision->collider = aabb;
+        sphereCollision->contactCount = 0;
+        sphereCollision->addContact(closest, contactNormal);
+
         return true;
     }
 
@@ -114,6 +121,29 @@ namespace UniDx
 {
 
 
+    // 登録先の物理ワールドを取得
+    PhysicsWorld* Collider::getPhysicsWorld() const
+    {
+        if (physicsWorld_ != nullptr) return physicsWorld_;
+        if (attachedRigidbody != nullptr) return attachedRigidbody->getPhysicsWorld();
+        return Physics::getInstance();
+    }
+
+
+    // 登録先が変わっていれば登録し直す
+    void Collider::updatePhysicsWorld()
+    {
+        if (registeredWorld_ == nullptr) return; // 無効な間は有効化したときに登録する
+
+        PhysicsWorld* world = getPhysicsWorld();
+        if (world == registeredWorld_) return;
+
+        registeredWorld_->unregister3d(this);
+        registeredWorld_ = world;
+        registeredWorld_->register3d(this);
+    }
+
+
     // TransformをたどってRigidbodyを探す
     Rigidbody* Collider::findNearestRigidbody(Transform* t) const
     {
@@ -138,14 +168,54 @@ namespace UniDx
     // ワールド空間における空間境界を取得
     Bounds SphereCollider::getBounds() const
     {
-        return Bounds(transform->position + transform->TransformVector(center), Vector3(radius, radius, radius));
+        // Transformも形状も変わっていなければ前回の結果を使う
+        if (transform->hasChangedSince(cachedBoundsVersion_) || center != cachedCenter_ || radius != cachedRadius_)
+        {
+            cachedBounds_ = Bounds(transform->position + transform->TransformVector(center), Vector3(radius, radius, radius));
+            cachedBoundsVersion_ = transform->getVersion();
+            cachedCenter_ = center;
+            cachedRadius_ = radius;
+        }
+        return cachedBounds_;
     }
 
 
     // ワールド空間における空間境界を取得
     Bounds AABBCollider::getBounds() const
     {
-        return Bounds(transform->position + transform->TransformVector(center), transform->TransformVector(size));
+        // Transformも形状も変わっていなければ前回の結果を使う
+        if (transform->hasChangedSince(cachedBoundsVersion_) || center != cachedCenter_ || size != cachedSize_)
+        {
+            cachedBounds_ = Bounds(transform->position + transform->TransformVector(center), transform->TransformVector(size));
+            cachedBoundsVersion_ = transform->getVersion();
+            cachedCenter_ = center;
+            cachedSize_ = size;
+        }
+        return cachedBounds_;
+    }
+
+
+    // スナップショット用のワールド空間の形状データを取得
+    void SphereCollider::getShapeData(PhysicsShapeData& data) const
+    {
+        data.collider = const_cast<SphereCollider*>(this);
+        data.type = PhysicsShapeType_Sphere;
+        data.isTrigger = isTrigger;
+        data.center = transform->TransformPoint(center);
+        data.radius = radius;
+        data.bounds = Bounds(data.center, Vector3(radius, radius, radius));
+    }
+
+
+    // スナップショット用のワールド空間の形状データを取得
+    void AABBCollider::getShapeData(PhysicsShapeData& data) const
+    {
+        data.collider = const_cast<AABBCollider*>(this);
+        data.type = PhysicsShapeType_AABB;
+        data.isTrigger = isTrigger;
+        data.bounds = getBounds();
+        data.center = data.bounds.Center;
+        data.radius = 0.0f;
     }
 
 
@@ -165,7 +235,7 @@ namespace UniDx
 
     // 衝突チェック
     // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-    bool AABBCollider::checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor)
+    bool AABBCollider::checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision)
     {
         return false;
     }
@@ -173,9 +243,11 @@ namespace UniDx
 
     // 衝突チェック
     // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-    bool AABBCollider::checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor)
+    bool AABBCollider::checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision)
     {
-        return checkIntersect_(other, this, otherActor, myActor);
+        if (!checkIntersect_(other, this, otherActor, myActor, collision)) return false;
+        *collision = collision->reversed(other); // 球側から見た情報なので反転
+        return true;
     }
 
 
@@ -184,9 +256,21 @@ namespace UniDx
     // - 始点がコライダー内部なら無視する
     //
     bool AABBCollider::Raycast(Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo)
+    {
+        if (!RaycastBounds(getBounds(), origin, direction, maxDistance, hitInfo)) return false;
+        if (hitInfo) hitInfo->collider = this;
+        return true;
+    }
+
+
+    //
+    // ワールド空間の境界に対するレイキャスト
+    // - Transform を参照しないので、スナップショットからも使える
+    // - hitInfo->collider は設定しない
+    //
+    bool AABBCollider::RaycastBounds(const Bounds& b, Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo)
     {
         const float eps = 1e-6f;
-        Bounds b = getBounds();
 
         // origin が内部にある場合は Unity と同様に無視する
         if (b.SqrDistance(origin) <= eps * eps)
@@ -275,7 +359,6 @@ namespace UniDx
                     if (len > eps) normal = invDir / len;
                 }
 
-                hitInfo->collider = this;
                 hitInfo->point = hitPoint;
                 hitInfo->normal = normal;
                 hitInfo->distance = tHit;
@@ -308,15 +391,15 @@ namespace UniDx
 
     // 衝突チェック
     // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-    bool SphereCollider::checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor)
+    bool SphereCollider::checkIntersect(AABBCollider* other, PhysicsActor* myActor, PhysicsActor* otherActor, Collision* collision)
     {
-        return checkIntersect_(this, other, myActor, otherActor);
+        return checkIntersect_(this, other, myActor, otherActor, collision);
     }
 
 
     // 衝突チェック
     // 衝突していれば attachedRigidbody に addCorrectPosition(), addCorrectVelocity() で補正する
-    bool SphereCollider::checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherShap)
+    bool SphereCollider::checkIntersect(SphereCollider* other, PhysicsActor* myActor, PhysicsActor* otherShap, Collision* collision)
     {
         Vector3 centerA = transform->TransformPoint(center);
         float radiusA = radius;
@@ -333,20 +416,33 @@ namespace UniDx
         // 中心の差
         Vector3 sub = centerB - centerA;
 
-        // それぞれの位置補正
-        Vector3 addB = sub.normalized();
-        addB *= penetration * 0.5f;
-
-        otherShap->addCorrectPosition(addB);
+        // 補正を受け持つ割合
+        // 物理LODでこのステップに計算しないものは動かないものとして扱い、相手が全て受け持つ
+        Rigidbody* rbA = attachedRigidbody;
+        Rigidbody* rbB = other->attachedRigidbody;
+        const bool movableA = rbA && !rbA->isKinematic && myActor && myActor->isSimulating();
+        const bool movableB = rbB && !rbB->isKinematic && otherShap && otherShap->isSimulating();
+        const float shareA = movableA ? (movableB ? 0.5f : 1.0f) : 0.0f;
+        const float shareB = movableB ? (movableA ? 0.5f : 1.0f) : 0.0f;
 
-        Vector3 addA = (-sub).normalized();
-        addA *= penetration * 0.5f;
+        // それぞれの位置補正
+        if (movableB)
+        {
+            Vector3 addB = sub.normalized();
+            addB *= penetration * shareB;
+            otherShap->addCorrectPosition(addB);
+        }
 
-        myActor->addCorrectPosition(addA);
+        if (movableA)
+        {
+            Vector3 addA = (-sub).normalized();
+            addA *= penetration * shareA;
+            myActor->addCorrectPosition(addA);
+        }
 
         // 跳ね返り計算
-        Vector3 va = attachedRigidbody->linearVelocity;
-        Vector3 vb = other->attachedRigidbody->linearVelocity;
+        Vector3 va = rbA ? rbA->linearVelocity : Vector3::zero;
+        Vector3 vb = rbB ? rbB->linearVelocity : Vector3::zero;
 
         // 相対速度
         Vector3 relV = va - vb;
@@ -360,9 +456,15 @@ namespace UniDx
         // 跳ね返り係数
         float bounce = bounciness * other->bounciness;
 
+        // 両方動くときはそれぞれ relVNormal * bounce、片方だけなら動くほうが両方の分を受け持つ
         Vector3 relVNormal = normal * Dot(relV, normal);
-        myActor->addCorrectVelocity(relVNormal * -bounce);
-        otherShap->addCorrectVelocity(relVNormal * bounce);
+        if (movableA) myActor->addCorrectVelocity(relVNormal * (-bounce * 2.0f * shareA));
+        if (movableB) otherShap->addCorrectVelocity(relVNormal * (bounce * 2.0f * shareB));
+
+        // 接触点はめり込みの中間、法線は相手から自分への向き
+        collision->collider = other;
+        collision->contactCount = 0;
+        collision->addContact(centerA + normal * (radiusA - penetration * 0.5f), -normal);
 
         return true;
     }
@@ -373,9 +475,21 @@ namespace UniDx
     // - 始点がコライダー内部なら無視する
     //
     bool SphereCollider::Raycast(Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo)
+    {
+        if (!RaycastSphere(transform->TransformPoint(center), radius, origin, direction, maxDistance, hitInfo)) return false;
+        if (hitInfo) hitInfo->collider = this;
+        return true;
+    }
+
+
+    //
+    // ワールド空間の球に対するレイキャスト
+    // - Transform を参照しないので、スナップショットからも使える
+    // - hitInfo->collider は設定しない
+    //
+    bool SphereCollider::RaycastSphere(Vector3 centerWorld, float radius, Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo)
     {
         const float eps = 1e-6f;
-        Vector3 centerWorld = transform->TransformPoint(center);
 
         // origin が内部にある場合は無視
         float distSqr = SqrDistance(origin, centerWorld);
@@ -411,7 +525,6 @@ namespace UniDx
             if (len > eps) normal /= len;
             else normal = Vector3(1, 0, 0);
 
-            hitInfo->collider = this;
             hitInfo->point = hitPoint;
             hitInfo->normal = normal;
             hitInfo->distance = t;
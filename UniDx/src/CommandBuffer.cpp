@@ -0,0 +1,58 @@
+﻿#include "pch.h"
+#include <UniDx/CommandBuffer.h>
+
+#include <UniDx/JobSystem.h>
+
+namespace UniDx
+{
+
+std::vector<CommandBuffer> CommandBuffer::buffers_;
+std::atomic<bool> CommandBuffer::recording_ = false;
+
+
+// 現在のスレッドで記録中のバッファ
+CommandBuffer* CommandBuffer::current()
+{
+    if (!recording_.load(std::memory_order_acquire)) return nullptr;
+
+    JobSystem* js = JobSystem::getInstance();
+    const size_t index = js != nullptr ? js->threadIndex() : 0;
+    return index < buffers_.size() ? &buffers_[index] : nullptr;
+}
+
+
+// 並列更新を始める
+void CommandBuffer::beginRecording(size_t threadCount)
+{
+    assert(!recording_);
+    if (buffers_.size() < threadCount)
+    {
+        buffers_.resize(threadCount);
+    }
+    recording_.store(true, std::memory_order_release);
+}
+
+
+// 並列更新を終え、記録されたコマンドを実行する
+void CommandBuffer::endRecording()
+{
+    recording_.store(false, std::memory_order_release);
+    for (auto& buffer : buffers_)
+    {
+        buffer.execute();
+    }
+}
+
+
+// 記録順に実行して空にする
+void CommandBuffer::execute()
+{
+    // 実行中に追加されることはない（記録は終わっている）
+    for (auto& command : commands_)
+    {
+        command();
+    }
+    commands_.clear();
+}
+
+}
@@ -1,31 +1,12 @@
 ﻿#include "pch.h"
 #include <UniDx/Component.h>
 
+#include <UniDx/PlayerLoop.h>
+
 namespace UniDx{
 
 // コンストラクタ
 Component::Component() :
-    Object([this]() { return gameObject != nullptr ? gameObject->name : StringId(); }),
-    enabled(
-        // get
-        [this]() { return _enabled && isCalledAwake; },
-
-        // set
-        [this](bool value) {
-            if (!_enabled && value && !isCalledDestroy) {
-                _enabled = true;
-                if (!isCalledAwake) { Awake(); isCalledAwake = true; }
-                OnEnable();
-            }
-            else if (_enabled && !value) {
-                _enabled = false;
-                if (isCalledAwake) { OnDisable(); }
-            }
-        }
-    ),
-    transform(
-        [this]() { return gameObject->transform; }
-    ),
     _enabled(true),
     isCalledAwake(false),
     isCalledStart(false),
@@ -34,6 +15,48 @@ Component::Component() :
 
 }
 
+// 複製用のコピーコンストラクタ
+// 有効フラグだけを写し、アタッチ先やプールは複製側で設定する
+Component::Component(const Component& source) :
+    _enabled(source._enabled),
+    isCalledAwake(false),
+    isCalledStart(false),
+    isCalledDestroy(false)
+{
+
+}
+
+// 有効フラグの設定
+void Component::setEnabled(const bool& value)
+{
+    if (auto commands = CommandBuffer::current())
+    {
+        // 並列更新中は実行リストを変更できないので同期点で実行
+        commands->add([this, value]() { setEnabled(value); });
+        return;
+    }
+
+    if (!_enabled && value && !isCalledDestroy) {
+        _enabled = true;
+        if (!isCalledAwake) { Awake(); isCalledAwake = true; }
+        OnEnable();
+        if (_enabled) registerLoop();
+    }
+    else if (_enabled && !value) {
+        _enabled = false;
+        unregisterLoop();
+        if (isCalledAwake) { OnDisable(); }
+    }
+}
+
+
+// 名前はアタッチ先のGameObjectの名前
+StringId Component::getName() const
+{
+    return gameObject != nullptr ? gameObject->name : StringId();
+}
+
+
 void Component::doDestroy()
 {
     isCalledDestroy = true; // 以降で enabled=true は無効
@@ -52,11 +75,33 @@ Component::~Component()
 {
 }
 
+// プールから確保したものはプールに返す
+void ComponentDeleter::operator()(Component* component) const
+{
+    if (component->pool_ != nullptr)
+    {
+        component->pool_->destroy(component);
+    }
+    else
+    {
+        delete component;
+    }
+}
+
 void Destroy(Component* component)
 {
     assert(component != nullptr);
+    if (auto commands = CommandBuffer::current())
+    {
+        commands->add([component]() { Destroy(component); });
+        return;
+    }
     component->enabled = false; // 無効化（ここはUniyと挙動が異なる）
     component->isCalledDestroy = true; // フレームの終わりに削除される
+    if (component->gameObject != nullptr)
+    {
+        if (auto loop = PlayerLoop::getInstance()) loop->enqueueDestroy(component->gameObject);
+    }
 }
 
 }
@@ -0,0 +1,393 @@
+﻿#include "pch.h"
+#include <UniDx/Coroutine.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <UniDx/Behaviour.h>
+#include <UniDx/Time.h>
+#include <UniDx/Profiler.h>
+
+namespace UniDx
+{
+
+namespace
+{
+
+// コルーチンのフレームのプール
+// 大きさを BlockAlign 単位に切り上げて種類を分け、種類ごとのフリーリストで再利用する。
+// 大きすぎるフレームは通常の new で確保する
+class FramePool
+{
+public:
+    void* allocate(size_t size)
+    {
+        const size_t c = classOf(size);
+        if (c >= ClassCount) return ::operator new(size);
+
+        if (free_[c] == nullptr) addChunk(c);
+        FreeBlock* block = free_[c];
+        free_[c] = block->next;
+        return block;
+    }
+
+    void deallocate(void* p, size_t size)
+    {
+        const size_t c = classOf(size);
+        if (c >= ClassCount)
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = free_[c];
+        free_[c] = block;
+    }
+
+private:
+    static constexpr size_t BlockAlign = 64;
+    static constexpr size_t ClassCount = 16;     // 1KB までをプールする
+    static constexpr size_t BlocksPerChunk = 32;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    FreeBlock* free_[ClassCount] = {};
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+
+    static size_t classOf(size_t size) { return size == 0 ? 0 : (size - 1) / BlockAlign; }
+
+    // チャンクを追加してフリーリストにつなぐ
+    void addChunk(size_t c)
+    {
+        const size_t blockSize = (c + 1) * BlockAlign;
+        chunks_.push_back(std::make_unique<std::byte[]>(blockSize * BlocksPerChunk));
+        std::byte* p = chunks_.back().get();
+        for (size_t i = BlocksPerChunk; i-- > 0;)
+        {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(p + i * blockSize);
+            block->next = free_[c];
+            free_[c] = block;
+        }
+    }
+};
+
+// 終了時の破棄順に依存しないよう、プール自体は解放しない
+FramePool& framePool()
+{
+    static FramePool* pool = new FramePool();
+    return *pool;
+}
+
+// 起きる時刻が早いものを先頭にする
+bool wakeLater(const auto& a, const auto& b)
+{
+    if (a.wakeTime != b.wakeTime) return a.wakeTime > b.wakeTime;
+    return a.order > b.order;
+}
+
+}
+
+
+void* Coroutine::promise_type::operator new(size_t size)
+{
+    return framePool().allocate(size);
+}
+
+
+void Coroutine::promise_type::operator delete(void* p, size_t size) noexcept
+{
+    framePool().deallocate(p, size);
+}
+
+
+// 待機用の型
+void WaitForNextFrame::await_suspend(Coroutine::Handle handle) const
+{
+    CoroutineScheduler::getInstance()->waitNextFrame(handle);
+}
+
+
+void WaitForSeconds::await_suspend(Coroutine::Handle handle) const
+{
+    CoroutineScheduler::getInstance()->waitSeconds(handle, seconds, false);
+}
+
+
+void WaitForSecondsRealtime::await_suspend(Coroutine::Handle handle) const
+{
+    CoroutineScheduler::getInstance()->waitSeconds(handle, seconds, true);
+}
+
+
+void WaitForFixedUpdate::await_suspend(Coroutine::Handle handle) const
+{
+    CoroutineScheduler::getInstance()->waitFixedUpdate(handle);
+}
+
+
+void WaitUntil::await_suspend(Coroutine::Handle handle) const
+{
+    CoroutineScheduler::getInstance()->waitPredicate(handle, &predicate_, true);
+}
+
+
+void WaitWhile::await_suspend(Coroutine::Handle handle) const
+{
+    CoroutineScheduler::getInstance()->waitPredicate(handle, &predicate_, false);
+}
+
+
+// デストラクタ
+// 残っているコルーチンのフレームを破棄する
+CoroutineScheduler::~CoroutineScheduler()
+{
+    for (auto& s : slots_)
+    {
+        if (s.handle) s.handle.destroy();
+    }
+}
+
+
+// owner のコルーチンとして開始し、最初の待機まで実行する
+CoroutineHandle CoroutineScheduler::start(Behaviour* owner, Coroutine routine)
+{
+    Coroutine::Handle h = std::exchange(routine.handle_, nullptr);
+    if (!h) return CoroutineHandle();
+
+    uint32_t slot;
+    if (freeSlot_ != None)
+    {
+        slot = freeSlot_;
+        freeSlot_ = slots_[slot].next;
+    }
+    else
+    {
+        slot = uint32_t(slots_.size());
+        slots_.emplace_back();
+    }
+
+    // owner のリストの先頭に追加
+    Slot& s = slots_[slot];
+    s.handle = h;
+    s.owner = owner;
+    s.prev = None;
+    s.next = owner->coroutineSlot_;
+    s.running = false;
+    s.stopRequested = false;
+    if (s.next != None) slots_[s.next].prev = slot;
+    owner->coroutineSlot_ = slot;
+
+    h.promise().slot = slot;
+    ++count_;
+
+    CoroutineHandle handle{ slot, s.generation };
+    resume(handle);
+    return handle;
+}
+
+
+// 停止してフレームを破棄する
+void CoroutineScheduler::stop(CoroutineHandle handle)
+{
+    if (!isValid(handle)) return;
+
+    unlink(handle.slot);
+    if (slots_[handle.slot].running)
+    {
+        // 実行中のフレームは破棄できないので、中断したところで破棄する
+        slots_[handle.slot].stopRequested = true;
+    }
+    else
+    {
+        release(handle.slot);
+    }
+}
+
+
+// owner の全てのコルーチンを停止する
+void CoroutineScheduler::stopAll(Behaviour* owner)
+{
+    while (owner->coroutineSlot_ != None)
+    {
+        const uint32_t slot = owner->coroutineSlot_;
+        unlink(slot);
+        if (slots_[slot].running)
+        {
+            slots_[slot].stopRequested = true;
+        }
+        else
+        {
+            release(slot);
+        }
+    }
+}
+
+
+bool CoroutineScheduler::isRunning(CoroutineHandle handle) const
+{
+    return isValid(handle) && !slots_[handle.slot].stopRequested;
+}
+
+
+// 待機の登録
+void CoroutineScheduler::waitNextFrame(Coroutine::Handle handle)
+{
+    frameWaits_.push_back(handleOf(handle));
+}
+
+
+void CoroutineScheduler::waitSeconds(Coroutine::Handle handle, float seconds, bool realtime)
+{
+    auto& heap = realtime ? realtimeWaits_ : scaledWaits_;
+    const float now = realtime ? Time::unscaledTime : Time::time;
+    heap.push_back({ now + seconds, timedOrder_++, handleOf(handle) });
+    std::push_heap(heap.begin(), heap.end(), [](const auto& a, const auto& b) { return wakeLater(a, b); });
+}
+
+
+void CoroutineScheduler::waitFixedUpdate(Coroutine::Handle handle)
+{
+    fixedWaits_.push_back(handleOf(handle));
+}
+
+
+void CoroutineScheduler::waitPredicate(Coroutine::Handle handle, const std::function<bool()>* predicate, bool expected)
+{
+    predicateWaits_.push_back({ predicate, expected, handleOf(handle) });
+}
+
+
+// WaitForFixedUpdate で待っているものを再開する
+void CoroutineScheduler::resumeFixedUpdate()
+{
+    if (fixedWaits_.empty()) return;
+    UNIDX_PROFILE_ZONE("CoroutineScheduler.resumeFixedUpdate");
+
+    ready_.clear();
+    std::swap(ready_, fixedWaits_);
+    resumeReady();
+}
+
+
+// 次のフレーム・秒数・条件を待っているものを再開する
+// 再開するものを全て集めてから再開するので、再開したコルーチンがすぐ起きる待機をしても次のフレームになる
+void CoroutineScheduler::resumeFrame()
+{
+    UNIDX_PROFILE_ZONE("CoroutineScheduler.resumeFrame");
+    ready_.clear();
+
+    // 次のフレーム
+    std::swap(ready_, frameWaits_);
+
+    // 秒数はヒープの先頭だけを調べる
+    popExpired(scaledWaits_, Time::time);
+    popExpired(realtimeWaits_, Time::unscaledTime);
+
+    // 条件
+    if (!predicateWaits_.empty())
+    {
+        std::swap(predicateBatch_, predicateWaits_);
+        for (auto& w : predicateBatch_)
+        {
+            if (!isValid(w.handle)) continue;
+
+            if ((*w.predicate)() == w.expected) ready_.push_back(w.handle);
+            else predicateWaits_.push_back(w);
+        }
+        predicateBatch_.clear();
+    }
+
+    resumeReady();
+}
+
+
+CoroutineHandle CoroutineScheduler::handleOf(Coroutine::Handle handle) const
+{
+    const uint32_t slot = handle.promise().slot;
+    return CoroutineHandle{ slot, slots_[slot].generation };
+}
+
+
+// 起きる時刻になったものをヒープから取り出す
+void CoroutineScheduler::popExpired(std::vector<TimedWait>& heap, float now)
+{
+    auto later = [](const auto& a, const auto& b) { return wakeLater(a, b); };
+    while (!heap.empty() && heap.front().wakeTime <= now)
+    {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        ready_.push_back(heap.back().handle);
+        heap.pop_back();
+    }
+}
+
+
+// 集めたものを順に再開する（停止されたものは飛ばす）
+void CoroutineScheduler::resumeReady()
+{
+    for (size_t i = 0; i < ready_.size(); ++i)
+    {
+        resume(ready_[i]);
+    }
+    ready_.clear();
+}
+
+
+// 次の待機まで実行し、終わっていれば破棄する
+void CoroutineScheduler::resume(CoroutineHandle handle)
+{
+    if (!isValid(handle) || slots_[handle.slot].running) return;
+
+    Coroutine::Handle h = slots_[handle.slot].handle;
+    slots_[handle.slot].running = true;
+    h.resume();
+
+    // 実行中に slots_ が伸びていることがあるので、参照は取り直す
+    Slot& s = slots_[handle.slot];
+    s.running = false;
+    if (h.done() || s.stopRequested)
+    {
+        release(handle.slot);
+    }
+}
+
+
+// owner のリストから外す
+void CoroutineScheduler::unlink(uint32_t slot)
+{
+    Slot& s = slots_[slot];
+    if (s.owner == nullptr) return;
+
+    if (s.prev != None) slots_[s.prev].next = s.next;
+    else s.owner->coroutineSlot_ = s.next;
+    if (s.next != None) slots_[s.next].prev = s.prev;
+
+    s.owner = nullptr;
+    s.prev = None;
+    s.next = None;
+}
+
+
+// スロットを空きに戻してフレームを破棄する
+// キューに残っているエントリは世代番号が合わなくなるので無視される
+void CoroutineScheduler::release(uint32_t slot)
+{
+    unlink(slot);
+
+    Slot& s = slots_[slot];
+    Coroutine::Handle h = s.handle;
+    s.handle = nullptr;
+    s.stopRequested = false;
+    ++s.generation;
+    s.next = freeSlot_;
+    freeSlot_ = slot;
+    --count_;
+
+    // ローカル変数のデストラクタから再び呼ばれてもよいよう、最後に破棄する
+    h.destroy();
+}
+
+} // namespace UniDx
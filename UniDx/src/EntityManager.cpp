@@ -0,0 +1,205 @@
+﻿#include "pch.h"
+#include <UniDx/EntityManager.h>
+
+#include <cstring>
+
+#include <UniDx/Transform.h>
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// アーキタイプ
+// 型ごとの配列がチャンクに収まるよう、チャンクあたりのエンティティ数を決める
+// -----------------------------------------------------------------------------
+EntityArchetype::EntityArchetype(std::vector<const EntityComponentType*> types) :
+    types_(std::move(types))
+{
+    size_t rowBytes = 0;
+    size_t padding = 0; // 配列の先頭を整列するための余白の上限
+    for (auto t : types_)
+    {
+        rowBytes += t->size;
+        padding += t->align;
+    }
+    assert(rowBytes + padding <= ChunkBytes);
+    capacity_ = uint32_t((ChunkBytes - padding) / rowBytes);
+
+    size_t offset = 0;
+    for (auto t : types_)
+    {
+        offset = (offset + t->align - 1) / t->align * t->align;
+        offsets_.push_back(uint32_t(offset));
+        offset += size_t(t->size) * capacity_;
+    }
+    assert(offset <= ChunkBytes);
+}
+
+
+EntityArchetype::~EntityArchetype()
+{
+    for (auto& chunk : chunks_)
+    {
+        ::operator delete(chunk.data, std::align_val_t(ChunkAlign));
+    }
+}
+
+
+// 型の位置。なければ -1
+int EntityArchetype::find(const void* type) const
+{
+    for (size_t i = 0; i < types_.size(); ++i)
+    {
+        if (types_[i]->id == type) return int(i);
+    }
+    return -1;
+}
+
+
+// 末尾に行を追加
+// 最後のチャンクが一杯なら新しいチャンクを確保する
+std::pair<uint32_t, uint32_t> EntityArchetype::addRow(Entity entity)
+{
+    if (chunks_.empty() || chunks_.back().count == capacity_)
+    {
+        Chunk chunk;
+        chunk.data = static_cast<std::byte*>(::operator new(ChunkBytes, std::align_val_t(ChunkAlign)));
+        chunks_.push_back(chunk);
+    }
+
+    const uint32_t c = uint32_t(chunks_.size() - 1);
+    const uint32_t row = chunks_[c].count++;
+    new (getComponent(c, row, 0)) Entity(entity); // 先頭の配列はエンティティ
+    ++count_;
+    return { c, row };
+}
+
+
+// 行を削除して、空いた位置に末尾の行を移す
+Entity EntityArchetype::removeRow(uint32_t chunk, uint32_t row)
+{
+    const uint32_t lastChunk = uint32_t(chunks_.size() - 1);
+    const uint32_t lastRow = chunks_[lastChunk].count - 1;
+
+    Entity moved;
+    if (chunk != lastChunk || row != lastRow)
+    {
+        for (size_t i = 0; i < types_.size(); ++i)
+        {
+            std::memcpy(getComponent(chunk, row, int(i)), getComponent(lastChunk, lastRow, int(i)), types_[i]->size);
+        }
+        moved = getEntities(chunks_[chunk])[row];
+    }
+
+    // 空になったチャンクは解放する（１つは残しておく）
+    if (--chunks_[lastChunk].count == 0 && chunks_.size() > 1)
+    {
+        ::operator delete(chunks_[lastChunk].data, std::align_val_t(ChunkAlign));
+        chunks_.pop_back();
+    }
+    --count_;
+    return moved;
+}
+
+
+// -----------------------------------------------------------------------------
+// エンティティマネージャ
+// -----------------------------------------------------------------------------
+EntityManager::EntityManager()
+{
+}
+
+
+EntityManager::~EntityManager()
+{
+}
+
+
+// エンティティを破棄
+// アーキタイプ内で移動したエンティティの格納場所を合わせる
+void EntityManager::DestroyEntity(Entity entity)
+{
+    if (!Exists(entity)) return;
+
+    Record& r = records_[entity.index];
+    Entity moved = r.archetype->removeRow(r.chunk, r.row);
+    if (!moved.isNull())
+    {
+        records_[moved.index].chunk = r.chunk;
+        records_[moved.index].row = r.row;
+    }
+
+    r.archetype = nullptr;
+    ++r.generation;
+    freeIndices_.push_back(entity.index);
+    --count_;
+}
+
+
+// システムを実行し、Transformとの橋渡しを行う
+void EntityManager::Update()
+{
+    for (auto& system : systems_)
+    {
+        system->OnUpdate(*this);
+    }
+
+    // ワールド行列の計算（Transformと同じく Scale * Rotation * Translation）
+    ParallelForEach<LocalTransform, LocalToWorld>([](const LocalTransform& t, LocalToWorld& m)
+        {
+            using namespace DirectX;
+            m.value.XMStore(XMMatrixAffineTransformation(
+                XMLoadFloat3(&t.scale), XMVectorZero(), t.rotation.XMLoad(), XMLoadFloat3(&t.position)));
+        });
+
+    // Transformへの書き戻し（Transformの変更はメインスレッドで行う）
+    // 破棄されたかプールに戻されたTransformのハンドルは引けないので飛ばす
+    const TransformHierarchy& hierarchy = *TransformHierarchy::getInstance();
+    ForEach<LocalTransform, TransformLink>([&hierarchy](const LocalTransform& t, TransformLink& link)
+        {
+            Transform* transform = hierarchy.find(link.transform);
+            if (transform == nullptr) return;
+            transform->position = t.position;
+            transform->rotation = t.rotation;
+        });
+}
+
+
+// 型の並びが一致するアーキタイプ。なければ作成
+EntityArchetype* EntityManager::getOrCreateArchetype(const std::vector<const EntityComponentType*>& types)
+{
+    for (auto& archetype : archetypes_)
+    {
+        if (archetype->matches(types)) return archetype.get();
+    }
+    archetypes_.push_back(std::make_unique<EntityArchetype>(types));
+    return archetypes_.back().get();
+}
+
+
+// エンティティの番号を割り当てて、アーキタイプに行を追加
+Entity EntityManager::allocate(EntityArchetype* archetype)
+{
+    uint32_t index;
+    if (!freeIndices_.empty())
+    {
+        index = freeIndices_.back();
+        freeIndices_.pop_back();
+    }
+    else
+    {
+        index = uint32_t(records_.size());
+        records_.emplace_back();
+    }
+
+    Record& r = records_[index];
+    const Entity entity{ index, r.generation };
+    auto [chunk, row] = archetype->addRow(entity);
+    r.archetype = archetype;
+    r.chunk = chunk;
+    r.row = row;
+    ++count_;
+    return entity;
+}
+
+}
@@ -0,0 +1,41 @@
+﻿#include "pch.h"
+#include <UniDx/EntityRenderer.h>
+
+#include <UniDx/D3DManager.h>
+#include <UniDx/FramePacket.h>
+
+namespace UniDx
+{
+
+// 対象のエンティティごとに、行列の転送と描画をパケットに写す
+void EntityRenderer::extract(FramePacket& packet)
+{
+    EntityManager* entities = EntityManager::getInstance();
+    if (entities == nullptr) return;
+
+    size_t n = 0;
+    entities->ForEach<LocalToWorld, RenderGroup>([this, &packet, &n](const LocalToWorld& m, const RenderGroup& g)
+        {
+            if (g.value != group) return;
+
+            // 足りなければ定数バッファを追加
+            if (n == buffers_.size())
+            {
+                D3D11_BUFFER_DESC desc{};
+                desc.ByteWidth = sizeof(ConstantBufferPerObject);
+                desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+                desc.CPUAccessFlags = 0;
+                desc.Usage = D3D11_USAGE_DEFAULT;
+                D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, buffers_.emplace_back().GetAddressOf());
+            }
+            const ComPtr<ID3D11Buffer>& buffer = buffers_[n++];
+
+            ConstantBufferPerObject cb{};
+            cb.world = m.value;
+            packet.addUpload(buffer, cb);
+            packet.addDraw(this, m.value, buffer, nullptr);
+            packet.addMesh(mesh, materials);
+        });
+}
+
+}
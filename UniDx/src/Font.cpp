@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <SpriteFont.h>
 #include <UniDx/D3DManager.h>
+#include <UniDx/Profiler.h>
 
 
 namespace UniDx
@@ -13,12 +14,13 @@ namespace UniDx
 using namespace DirectX;
 
 
-Font::Font() : Object([this]() { return fileName; })
+Font::Font()
 {
 }
 
 bool Font::Load(std::wstring filePath)
 {
+	UNIDX_PROFILE_ZONE("Font.Load");
 	spriteFont = std::make_unique<DirectX::SpriteFont>(D3DManager::getInstance()->GetDevice().Get(), filePath.c_str());
 	std::filesystem::path path(filePath);
 	fileName = StringId::intern(path.filename().u8string());
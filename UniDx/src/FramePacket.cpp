@@ -0,0 +1,157 @@
+﻿#include "pch.h"
+#include <UniDx/FramePacket.h>
+
+#include <UniDx/D3DManager.h>
+#include <UniDx/Mesh.h>
+#include <UniDx/Material.h>
+#include <UniDx/Profiler.h>
+
+namespace UniDx
+{
+
+namespace
+{
+// 抽出の番号（メインスレッドだけが使う）
+uint64_t nextSerial = 0;
+}
+
+
+// 次のフレームの抽出のために空にする
+void FramePacket::clear()
+{
+    serial_ = ++nextSerial;
+    frameCount = 0;
+    hasCamera = false;
+    cameraBuffer = nullptr;
+    lightBuffer = nullptr;
+    draws.clear();
+    subMeshes.clear();
+    materials.clear();
+    uploads.clear();
+    uploadData.clear();
+    overlays.clear();
+}
+
+
+// 描画の前に buffer へ data を転送する
+void FramePacket::addUpload(const ComPtr<ID3D11Buffer>& buffer, const void* data, size_t size)
+{
+    if (size == 0) return;
+
+    const size_t offset = uploadData.size();
+    uploadData.resize(offset + size);
+    std::memcpy(uploadData.data() + offset, data, size);
+    uploads.push_back({ buffer, uint32_t(offset), uint32_t(size) });
+}
+
+
+// 描画を追加
+FrameDraw& FramePacket::addDraw(const Renderer* renderer, const Matrix4x4& world,
+    const ComPtr<ID3D11Buffer>& perObject, const ComPtr<ID3D11Buffer>& lightPerObject)
+{
+    FrameDraw& draw = draws.emplace_back();
+    draw.renderer = renderer;
+    draw.world = world;
+    draw.perObject = perObject;
+    draw.lightPerObject = lightPerObject;
+    draw.firstSubMesh = uint32_t(subMeshes.size());
+    draw.firstMaterial = uint32_t(materials.size());
+    return draw;
+}
+
+
+// 最後に追加した描画のメッシュとマテリアルを設定
+void FramePacket::addMesh(const Mesh& mesh, std::span<const std::shared_ptr<Material>> mats)
+{
+    assert(!draws.empty());
+    FrameDraw& draw = draws.back();
+
+    subMeshes.insert(subMeshes.end(), mesh.submesh.begin(), mesh.submesh.end());
+    draw.subMeshCount = uint32_t(subMeshes.size()) - draw.firstSubMesh;
+
+    for (auto& m : mats)
+    {
+        if (m != nullptr)
+        {
+            // 共有されているマテリアルの定数も１フレームに１度だけ転送する
+            m->extract(*this);
+            draw.renderingModes |= 1u << m->renderingMode;
+        }
+        materials.push_back(m);
+    }
+    draw.materialCount = uint32_t(materials.size()) - draw.firstMaterial;
+}
+
+
+// D3Dのコンテキストに描画して画面に表示する
+void FramePacket::execute() const
+{
+    UNIDX_PROFILE_ZONE("FramePacket.execute");
+    D3DManager* d3d = D3DManager::getInstance();
+    auto& context = d3d->GetContext();
+
+    // 画面を塗りつぶす
+    d3d->Clear(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+
+    // 定数バッファの転送
+    for (auto& u : uploads)
+    {
+        if (u.buffer == nullptr) continue;
+        context->UpdateSubresource(u.buffer.Get(), 0, nullptr, uploadData.data() + u.offset, 0, 0);
+    }
+
+    // ライト
+    if (lightBuffer != nullptr)
+    {
+        context->UpdateSubresource(lightBuffer.Get(), 0, nullptr, &lights, 0, 0);
+        ID3D11Buffer* cbs[1] = { lightBuffer.Get() };
+        context->PSSetConstantBuffers(CB_LightPerFrame, 1, cbs);
+    }
+
+    if (hasCamera)
+    {
+        // カメラ単位の定数バッファ
+        context->UpdateSubresource(cameraBuffer.Get(), 0, nullptr, &camera, 0, 0);
+        ID3D11Buffer* cbs[1] = { cameraBuffer.Get() };
+        context->VSSetConstantBuffers(CB_PerCamera, 1, cbs);
+        context->PSSetConstantBuffers(CB_PerCamera, 1, cbs);
+
+        // 不透明、半透明の順に描画
+        renderPass(RenderingMode_Opaque);
+        renderPass(RenderingMode_Transparent);
+    }
+
+    // UI
+    for (auto& overlay : overlays)
+    {
+        overlay();
+    }
+
+    // バックバッファの内容を画面に表示
+    UNIDX_PROFILE_ZONE("D3DManager.present");
+    d3d->Present();
+}
+
+
+// レンダリングモードが一致するマテリアルを持つ描画を、抽出した順に行う
+void FramePacket::renderPass(RenderingMode mode) const
+{
+    D3DManager* d3d = D3DManager::getInstance();
+    auto& context = d3d->GetContext();
+    d3d->setCurrentCurrentRenderingMode(mode);
+
+    forEachDraw(mode, [&](const FrameDraw& draw)
+        {
+            ID3D11Buffer* cbs[1] = { draw.perObject.Get() };
+            context->VSSetConstantBuffers(CB_PerObject, 1, cbs);
+            if (draw.lightPerObject != nullptr)
+            {
+                ID3D11Buffer* lightCbs[1] = { draw.lightPerObject.Get() };
+                context->PSSetConstantBuffers(CB_LightPerObject, 1, lightCbs);
+            }
+
+            Mesh::render(getSubMeshes(draw), getMaterials(draw));
+        });
+}
+
+}
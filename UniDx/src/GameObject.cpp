@@ -1,6 +1,7 @@
 ﻿#include "pch.h"
 
 #include <UniDx/Behaviour.h>
+#include <UniDx/PlayerLoop.h>
 
 
 namespace UniDx{
@@ -9,6 +10,12 @@ namespace UniDx{
 // コンポーネントのデストラクタより前にdoDestroy()を呼んでおく
 GameObject::~GameObject()
 {
+	// 削除待ちのまま破棄されたときは待ちから外す
+	if (destroyQueued_)
+	{
+		if (auto loop = PlayerLoop::getInstance()) loop->cancelDestroy(this);
+	}
+
 	for (auto& i : components)
 	{
 		i->doDestroy(); // 破棄処理
@@ -17,106 +24,109 @@ GameObject::~GameObject()
 
 
 // Destroy()が呼ばれたコンポーネントを削除
-// 自身を削除する場合 true
-bool GameObject::checkDestroy()
+void GameObject::removeDestroyedComponents()
 {
-	// 自身の削除チェック
-	if (isCalledDestroy && transform->parent != nullptr)
-	{
-		transform->SetParent(nullptr);
-		return true;
-	}
-
-	// 子供のオブジェクトについて再帰
-	for(int i = 0; i < transform->getChildGameObjects().size();)
-	{
-		auto& o = transform->getChildGameObjects()[i];
-		if (!o->checkDestroy())
-		{
-			++i; // 削除しないとき次
-		}
-	}
-
-	// Destroyが呼ばれたコンポーネントを削除
 	for (auto it = components.begin(); it != components.end();)
 	{
 		if ((*it) != nullptr && (*it)->isDestroyed())
 		{
 			(*it)->doDestroy(); // 破棄処理
 			it = components.erase(it); // コンポーネントを削除
+			invalidateTypeIndex();
 		}
 		else
 		{
 			++it;
 		}
 	}
-	return false;
 }
 
 
-void GameObject::onTriggerEnter(Collider* other)
+// 静的なオブジェクトか
+bool GameObject::getStatic() const
 {
-	for (auto& i : components)
+	return transform->isStatic();
+}
+
+
+void GameObject::setStatic(bool value)
+{
+	transform->setStatic(value);
+}
+
+
+// 物理のコールバックを通知先の Behaviour に呼ぶ
+// 通知先がなければ何もしない
+template<typename F>
+void GameObject::dispatchPhysics(uint8_t callback, F&& f)
+{
+	if (physicsListenersDirty_)
+	{
+		// 型の索引を使うので dynamic_cast は作り直したときだけ
+		physicsListeners_.clear();
+		for (Component* c : findComponents<Behaviour>())
+		{
+			Behaviour* b = static_cast<Behaviour*>(c);
+			if (b->physicsCallbacks_ != 0) physicsListeners_.push_back(b);
+		}
+		physicsListenersDirty_ = false;
+	}
+
+	// コールバックの中で通知先が変わっても、作り直すのは次の通知の前
+	for (size_t i = 0; i < physicsListeners_.size(); ++i)
 	{
-		Behaviour* b = dynamic_cast<Behaviour*>(i.get());
-		if(b != nullptr) b->OnTriggerEnter(other);
+		Behaviour* b = physicsListeners_[i];
+		if (b->physicsCallbacks_ & callback) f(b);
 	}
 }
 
 
+void GameObject::onTriggerEnter(Collider* other)
+{
+	dispatchPhysics(PhysicsCallback_TriggerEnter, [other](Behaviour* b) { b->OnTriggerEnter(other); });
+}
+
+
 void GameObject::onTriggerStay(Collider* other)
 {
-	for (auto& i : components)
-	{
-		Behaviour* b = dynamic_cast<Behaviour*>(i.get());
-		if(b != nullptr) b->OnTriggerStay(other);
-	}
+	dispatchPhysics(PhysicsCallback_TriggerStay, [other](Behaviour* b) { b->OnTriggerStay(other); });
 }
 
 
 void GameObject::onTriggerExit(Collider* other)
 {
-	for (auto& i : components)
-	{
-		Behaviour* b = dynamic_cast<Behaviour*>(i.get());
-		if(b != nullptr) b->OnTriggerExit(other);
-	}
+	dispatchPhysics(PhysicsCallback_TriggerExit, [other](Behaviour* b) { b->OnTriggerExit(other); });
 }
 
 
 void GameObject::onCollisionEnter(const Collision& collision)
 {
-	for (auto& i : components)
-	{
-		Behaviour* b = dynamic_cast<Behaviour*>(i.get());
-		if(b != nullptr) b->OnCollisionEnter(collision);
-	}
+	dispatchPhysics(PhysicsCallback_CollisionEnter, [&collision](Behaviour* b) { b->OnCollisionEnter(collision); });
 }
 
 
 void GameObject::onCollisionStay(const Collision& collision)
 {
-	for (auto& i : components)
-	{
-		Behaviour* b = dynamic_cast<Behaviour*>(i.get());
-		if(b != nullptr) b->OnCollisionStay(collision);
-	}
+	dispatchPhysics(PhysicsCallback_CollisionStay, [&collision](Behaviour* b) { b->OnCollisionStay(collision); });
 }
 
 
 void GameObject::onCollisionExit(const Collision& collision)
 {
-	for (auto& i : components)
-	{
-		Behaviour* b = dynamic_cast<Behaviour*>(i.get());
-		if(b != nullptr) b->OnCollisionExit(collision);
-	}
+	dispatchPhysics(PhysicsCallback_CollisionExit, [&collision](Behaviour* b) { b->OnCollisionExit(collision); });
 }
 
 void Destroy(GameObject* gameObject)
 {
 	assert(gameObject != nullptr);
+	if (auto commands = CommandBuffer::current())
+	{
+		// 並列更新中は同期点で実行
+		commands->add([gameObject]() { Destroy(gameObject); });
+		return;
+	}
 	gameObject->isCalledDestroy = true; // フレームの終わりに削除される
+	if (auto loop = PlayerLoop::getInstance()) loop->enqueueDestroy(gameObject);
 }
 
 }
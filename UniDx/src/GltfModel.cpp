@@ -1,5 +1,7 @@
 ﻿#include "pch.h"
 #include <UniDx/GltfModel.h>
+#include <UniDx/Prefab.h>
+#include <UniDx/Profiler.h>
 
 #include <tiny_gltf.h>
 #include <codecvt>
@@ -174,9 +176,10 @@ void ReadAccessorU8x4(
 // -----------------------------------------------------------------------------
 bool GltfModel::load_(const char* filePath, bool makeTextureMaterial, std::shared_ptr<Shader> shader)
 {
+    UNIDX_PROFILE_ZONE("GltfModel.Load");
     Debug::Log(filePath);
 
-    model = make_unique<tinygltf::Model>();
+    model = make_shared<tinygltf::Model>();
     tinygltf::TinyGLTF loader;
     string err, warn;
 
@@ -229,13 +232,23 @@ bool GltfModel::load_(const char* filePath, bool makeTextureMaterial, std::share
     }
 
     // ノードから階層構造を作りながら姿勢を取得
+    // GameObjectはノードを集め終わってからまとめて作成する
     nodes.clear();
     renderer.clear();
     int sceneIndex = model->defaultScene >= 0 ? model->defaultScene : 0;
     const auto& scene = model->scenes[sceneIndex];
+    HierarchyBuilder builder;
+    builder.reserve(model->nodes.size());
+    vector<int> builtNodes; // builder のノード順に並べた glTF のノード番号
+    builtNodes.reserve(model->nodes.size());
     for (int nodeIndex : scene.nodes)
     {
-        createNodeRecursive(*model.get(), nodeIndex, gameObject, makeTextureMaterial);
+        createNodeRecursive(*model.get(), nodeIndex, -1, builder, builtNodes, makeTextureMaterial);
+    }
+    auto created = builder.build(transform);
+    for (size_t i = 0; i < created.size(); ++i)
+    {
+        nodes[builtNodes[i]] = created[i]->transform;
     }
 
     // スキン情報の後処理
@@ -280,6 +293,48 @@ bool GltfModel::load_(const char* filePath, bool makeTextureMaterial, std::share
 }
 
 
+// -----------------------------------------------------------------------------
+// Prefab からの複製
+// スキン情報は複製先のものを使うよう、対応を map に登録しておく
+// -----------------------------------------------------------------------------
+ComponentPtr<Component> GltfModel::clone(CloneMap& map) const
+{
+    auto c = MakeComponent<GltfModel>(*this);
+    for (auto& pair : c->skinInstance)
+    {
+        map.add(&skinInstance.at(pair.first), &pair.second);
+    }
+    return c;
+}
+
+
+// -----------------------------------------------------------------------------
+// 複製元の階層を指している参照を複製先のものに置き換える
+// -----------------------------------------------------------------------------
+void GltfModel::resolveClone(const CloneMap& map)
+{
+    for (auto& r : renderer)
+    {
+        r = map(r);
+    }
+    for (auto& pair : nodes)
+    {
+        pair.second = map(pair.second);
+    }
+    for (auto& pair : skinInstance)
+    {
+        for (auto& r : pair.second.reference)
+        {
+            r = map(r);
+        }
+        for (auto& j : pair.second.joints)
+        {
+            j = map(j);
+        }
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // 頂点情報を格納したプリミティブを読み取り
 // -----------------------------------------------------------------------------
@@ -465,16 +520,11 @@ std::shared_ptr<Texture> GltfModel::getOrCreateTextureFromGltf_(int textureIndex
 // node生成
 // -----------------------------------------------------------------------------
 void GltfModel::createNodeRecursive(const tinygltf::Model& model,
-    int nodeIndex,
-    GameObject* parentGO, bool attachIncludeMaterial)
+    int nodeIndex, int parentNode,
+    HierarchyBuilder& builder, vector<int>& builtNodes, bool attachIncludeMaterial)
 
 {
     const tinygltf::Node& node = model.nodes[nodeIndex];
-    assert(parentGO);
-
-    // GameObject を作成
-    unique_ptr<GameObject> go = make_unique<GameObject>(StringId::intern(node.name));
-    Debug::Log(go->name);
 
     // 行列を取得
     Matrix4x4 localRH;
@@ -507,9 +557,10 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
     Quaternion rotation;
     localLH.Decompose(scale, rotation, position);
 
-    go->transform->localScale = scale;
-    go->transform->localRotation = rotation;
-    go->transform->localPosition = position;
+    // GameObject のノードを追加
+    const int index = builder.add(StringId::intern(node.name), parentNode, position, rotation, scale);
+    builtNodes.push_back(nodeIndex);
+    Debug::Log(builder.node(index).name);
 
     // メッシュを持っていればアタッチ
     if (node.mesh >= 0 && node.mesh < meshes.size())
@@ -520,7 +571,7 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
         if(0 <= node.skin && node.skin < model.skins.size())
         {
             // スキニングメッシュ
-            SkinnedMeshRenderer* sr = go->AddComponent<SkinnedMeshRenderer>();
+            SkinnedMeshRenderer* sr = builder.addComponent<SkinnedMeshRenderer>(index);
             skinInstance[node.skin].reference.push_back(sr);
             sr->skin = &skinInstance[node.skin];
             r = sr;
@@ -528,7 +579,7 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
         else
         {
             // 固定メッシュ
-            r = go->AddComponent<MeshRenderer>();
+            r = builder.addComponent<MeshRenderer>(index);
         }
         renderer.push_back(r);
         r->mesh = *meshes[node.mesh]; // メッシュのコピー
@@ -554,18 +605,10 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
         }
     }
 
-    // 親を設定
-    GameObject* ptr = go.get();
-    if (parentGO)
-    {
-        Transform::SetParent(move(go), parentGO->transform);
-    }
-    nodes[nodeIndex] = ptr->transform;
-
     // 子ノードを再帰
     for (int child : node.children)
     {
-        createNodeRecursive(model, child, ptr, attachIncludeMaterial);
+        createNodeRecursive(model, child, index, builder, builtNodes, attachIncludeMaterial);
     }
 }
 
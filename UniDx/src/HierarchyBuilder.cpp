@@ -0,0 +1,80 @@
+﻿#include "pch.h"
+#include <UniDx/HierarchyBuilder.h>
+
+#include <UniDx/Transform.h>
+
+namespace UniDx
+{
+
+using namespace std;
+
+// ノードを追加してそのインデックスを返す
+int HierarchyBuilder::add(StringId name, int parent,
+    const Vector3& localPosition, const Quaternion& localRotation, const Vector3& localScale)
+{
+    assert(parent < (int)nodes_.size());
+
+    Node& n = nodes_.emplace_back();
+    n.name = name;
+    n.parent = parent;
+    n.localPosition = localPosition;
+    n.localRotation = localRotation;
+    n.localScale = localScale;
+    return (int)nodes_.size() - 1;
+}
+
+
+// 階層を作成して root の子にする
+vector<GameObject*> HierarchyBuilder::build(Transform* root)
+{
+    assert(root != nullptr);
+
+    const size_t count = nodes_.size();
+    vector<GameObject*> created(count, nullptr);
+
+    // 子の数を数えて、子の配列を一度で確保できるようにする
+    vector<uint32_t> childCounts(count, 0);
+    size_t rootChildCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int p = nodes_[i].parent;
+        assert(p < (int)i); // 親が先に並んでいること
+        if (p >= 0) ++childCounts[p];
+        else ++rootChildCount;
+    }
+    root->children.reserve(root->children.size() + rootChildCount);
+
+    TransformHierarchy& h = *TransformHierarchy::getInstance();
+    for (size_t i = 0; i < count; ++i)
+    {
+        Node& node = nodes_[i];
+        auto go = make_unique<GameObject>(node.name);
+        for (auto& comp : node.components)
+        {
+            go->Add(move(comp));
+        }
+
+        // 姿勢はプロパティを通さず直接書き込む（登録直後なのでダーティになっている）
+        Transform* t = go->transform;
+        t->children.reserve(childCounts[i]);
+        h.localPositions_[t->index_] = node.localPosition;
+        h.localRotations_[t->index_] = node.localRotation;
+        h.localScales_[t->index_] = node.localScale;
+
+        // 親につなぐ
+        Transform* parent = node.parent >= 0 ? created[node.parent]->transform : root;
+        t->parent = parent;
+        h.parents_[t->index_] = parent->index_;
+        created[i] = go.get();
+        parent->addChild(move(go));
+    }
+    nodes_.clear();
+
+    // 並べ替えとワールド行列の計算をまとめて行う
+    h.orderDirty_ = true;
+    h.update();
+
+    return created;
+}
+
+}
@@ -6,6 +6,7 @@
 #include <UniDx/Material.h>
 #include <UniDx/Shader.h>
 #include <UniDx/ConstantBuffer.h>
+#include <UniDx/FramePacket.h>
 
 using namespace DirectX;
 
@@ -27,7 +28,7 @@ namespace UniDx {
 // コンストラクタ
 Image::Image()
 {
-	mesh = make_unique<SubMesh>();
+	mesh = make_shared<SubMesh>();
 	mesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
 	colors.resize(4, Color(1, 1, 1, 1));
 }
@@ -51,17 +52,18 @@ void Image::OnEnable()
 }
 
 
-void Image::render(const Matrix4x4& proj) const
+void Image::extract(FramePacket& packet, const Matrix4x4& proj) const
 {
-	UIBehaviour::render(proj);
+	UIBehaviour::extract(packet, proj);
 
+	std::shared_ptr<Material> material;
 	if (texture == nullptr)
 	{
 		if (mesh->vertexBuffer == nullptr)
 		{
 			mesh->createBuffer<VertexPC>();
 		}
-		owner->getDefaultMaterial()->bind();
+		material = owner->getDefaultMaterial();
 	}
 	else
 	{
@@ -69,21 +71,27 @@ void Image::render(const Matrix4x4& proj) const
 		{
 			mesh->createBuffer<VertexPTC>();
 		}
-		owner->getDefaultTextureMaterial()->bind();
+		material = owner->getDefaultTextureMaterial();
 	}
-
-	// 定数バッファ
-	ID3D11Buffer* cbs[1] = { constantBufferPerObject.Get() };
-	D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(CB_PerObject, 1, cbs);
+	material->extract(packet);
 
 	// ─ ワールド行列を位置に合わせて作成
 	ConstantBufferPerObject cb{};
 	cb.world = transform->localToWorldMatrix();
 
 	// 定数バッファ更新
-	D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferPerObject.Get(), 0, nullptr, &cb, 0, 0);
+	packet.addUpload(constantBufferPerObject, cb);
+
+	// 描画
+	packet.overlays.push_back([material, mesh = mesh, cbuffer = constantBufferPerObject]()
+		{
+			material->bind();
+
+			ID3D11Buffer* cbs[1] = { cbuffer.Get() };
+			D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(CB_PerObject, 1, cbs);
 
-	mesh->render();
+			mesh->render();
+		});
 }
 
 }
@@ -0,0 +1,174 @@
+﻿#include "pch.h"
+#include <UniDx/JobSystem.h>
+#include <UniDx/Profiler.h>
+
+namespace UniDx
+{
+
+namespace
+{
+// このスレッドが担当するキュー（ワーカー以外は SIZE_MAX）
+thread_local size_t workerIndex = SIZE_MAX;
+}
+
+
+// コンストラクタ
+// ワーカースレッドを起動する
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    if (workerCount == 0)
+    {
+        const unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    for (unsigned int i = 0; i < workerCount + 1; ++i)
+    {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back(&JobSystem::workerMain, this, i);
+    }
+}
+
+
+// デストラクタ
+// 残っているジョブを実行し終えてからワーカースレッドを終了する
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(sleepMutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_)
+    {
+        t.join();
+    }
+}
+
+
+// ジョブを登録する
+void JobSystem::schedule(Job job, JobCounter* counter)
+{
+    if (counter) counter->count_.fetch_add(1, std::memory_order_relaxed);
+
+    if (workers_.empty())
+    {
+        // ワーカーがいなければその場で実行
+        Entry entry{ std::move(job), counter };
+        run(entry);
+        return;
+    }
+
+    Queue& q = *queues_[threadIndex()];
+    {
+        std::lock_guard lock(q.mutex);
+        q.entries.push_back({ std::move(job), counter });
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+
+    // 寝ているワーカーを起こす
+    {
+        std::lock_guard lock(sleepMutex_);
+    }
+    wake_.notify_one();
+}
+
+
+// counter が 0 になるまで、ジョブを実行しながら待つ
+void JobSystem::wait(const JobCounter& counter)
+{
+    const size_t self = threadIndex();
+    Entry entry;
+    while (!counter.isDone())
+    {
+        if (pop(self, entry))
+        {
+            run(entry);
+        }
+        else
+        {
+            // 他のスレッドが実行中のジョブの完了を待つ
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+// ワーカースレッドの処理
+void JobSystem::workerMain(size_t index)
+{
+    workerIndex = index;
+    Profiler::setThreadName(("Worker " + std::to_string(index)).c_str());
+
+    Entry entry;
+    while (true)
+    {
+        if (pop(index, entry))
+        {
+            run(entry);
+            continue;
+        }
+
+        // ジョブがなければ登録されるまで眠る
+        std::unique_lock lock(sleepMutex_);
+        wake_.wait(lock, [this]() { return quit_ || pending_.load(std::memory_order_acquire) > 0; });
+        if (quit_ && pending_.load(std::memory_order_acquire) == 0) break;
+    }
+}
+
+
+// 実行できるジョブを1つ取り出す
+bool JobSystem::pop(size_t self, Entry& out)
+{
+    if (pending_.load(std::memory_order_acquire) == 0) return false;
+
+    // 自分のキューは後ろから（最後に登録したものはキャッシュに残っている）
+    {
+        Queue& q = *queues_[self];
+        std::lock_guard lock(q.mutex);
+        if (!q.entries.empty())
+        {
+            out = std::move(q.entries.back());
+            q.entries.pop_back();
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // 他のキューからは前から盗む
+    const size_t n = queues_.size();
+    for (size_t k = 1; k < n; ++k)
+    {
+        Queue& q = *queues_[(self + k) % n];
+        std::lock_guard lock(q.mutex);
+        if (!q.entries.empty())
+        {
+            out = std::move(q.entries.front());
+            q.entries.pop_front();
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void JobSystem::run(Entry& entry)
+{
+    UNIDX_PROFILE_ZONE("JobSystem.job");
+    entry.job();
+    entry.job = nullptr;
+    if (entry.counter) entry.counter->count_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+
+// このスレッドの番号（キューの番号。ワーカー以外は共有キュー）
+size_t JobSystem::threadIndex() const
+{
+    return workerIndex != SIZE_MAX ? workerIndex : workers_.size();
+}
+
+}
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <UniDx/Light.h>
 #include <UniDx/D3DManager.h>
+#include <UniDx/FramePacket.h>
 
 
 namespace UniDx
@@ -60,10 +61,10 @@ LightManager::LightManager()
     desc.Usage = D3D11_USAGE_DEFAULT;
 
     desc.ByteWidth = sizeof(ConstantBufferLightPerFrame);
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBufferLightPerFrame.GetAddressOf());
-
-    desc.ByteWidth = sizeof(ConstantBufferLightPerObject);
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBufferLightPerObject.GetAddressOf());
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBuffer(&desc, nullptr, constantBufferLightPerFrame.GetAddressOf());
+    }
 }
 
 
@@ -107,8 +108,26 @@ void LightManager::unregisterLight(Light* light)
 }
 
 
-// ライト情報を定数バッファに反映
-void LightManager::updateLightCBuffer()
+// オブジェクトごとのライト情報用の定数バッファを作成
+ComPtr<ID3D11Buffer> LightManager::createLightCBufferObject()
+{
+    D3D11_BUFFER_DESC desc{};
+    desc.ByteWidth = sizeof(ConstantBufferLightPerObject);
+    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    desc.CPUAccessFlags = 0;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+
+    ComPtr<ID3D11Buffer> buffer;
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBuffer(&desc, nullptr, buffer.GetAddressOf());
+    }
+    return buffer;
+}
+
+
+// フレーム共通のライト情報をパケットに写す
+void LightManager::extract(FramePacket& packet)
 {
     // 無効になっているものをvectorから削除
     for (vector<Light*>::iterator it = lights_.begin(); it != lights_.end();)
@@ -123,8 +142,29 @@ void LightManager::updateLightCBuffer()
         }
     }
 
-    // 定数バッファ更新
-    ConstantBufferLightPerFrame cb{};
+    // 前フレームからライトの構成・姿勢・パラメータが変わっていたら世代を進める
+    bool changed = lightStates_.size() != lights_.size();
+    lightStates_.resize(lights_.size());
+    for (size_t i = 0; i < lights_.size(); ++i)
+    {
+        Light* l = lights_[i];
+        LightState state{ l, l->transform->getVersion(), l->color, int(l->type), l->intensity, l->range, l->spotAngle };
+        LightState& prev = lightStates_[i];
+        if (prev.light != state.light || prev.transformVersion != state.transformVersion || prev.color != state.color
+            || prev.type != state.type || prev.intensity != state.intensity || prev.range != state.range || prev.spotAngle != state.spotAngle)
+        {
+            prev = state;
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        ++lightsVersion_;
+    }
+
+    // 定数バッファの内容
+    ConstantBufferLightPerFrame& cb = packet.lights;
+    cb = {};
     cb.ambientColor = ambientColor;
     cb.directionalColor = Color(0.0f, 0.0f, 0.0f, 0.0f);
     cb.directionW = Vector3::forward;
@@ -140,13 +180,12 @@ void LightManager::updateLightCBuffer()
             cb.directionW = (*it)->transform->forward;
         }
     }
-    D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferLightPerFrame.Get(), 0, nullptr, &cb, 0, 0);
-
-    ID3D11Buffer* cbs[1] = { constantBufferLightPerFrame.Get() };
-    D3DManager::getInstance()->GetContext()->PSSetConstantBuffers(CB_LightPerFrame, 1, cbs);
+    packet.lightBuffer = constantBufferLightPerFrame;
 }
 
-void LightManager::updateLightCBufferObject(Vector3 objPos, int lightCountMax)
+
+// オブジェクトの位置に影響の大きいライトを選んで、指定した定数バッファへの転送としてパケットに写す
+void LightManager::extractLightCBufferObject(FramePacket& packet, Vector3 objPos, int lightCountMax, const ComPtr<ID3D11Buffer>& buffer)
 {
     int pointLightMax = std::clamp(lightCountMax, 0, PointLightCountMax);
     int spotLightMax = std::clamp(lightCountMax, 0, SpotLightCountMax);
@@ -158,7 +197,6 @@ void LightManager::updateLightCBufferObject(Vector3 objPos, int lightCountMax)
 
     for (Light* l : lights_)
     {
-        auto world = l->transform->localToWorldMatrix();       // ワールド行列取得
         float rangeInv = l->range != 0.0f ? 1.0f / l->range : 0.0f;
 
         bool popPoint = false; // ポイントライトの削除が必要か
@@ -229,16 +267,13 @@ void LightManager::updateLightCBufferObject(Vector3 objPos, int lightCountMax)
         }
     }
 
-    // 定数バッファ更新
+    // 定数バッファの内容
     ConstantBufferLightPerObject cb{};
     cb.pointLightCount = uint32_t(pointLights.size());
     std::copy(pointLights.begin(), pointLights.end(), cb.pointLights);
     cb.spotLightCount = uint32_t(spotLights.size());
     std::copy(spotLights.begin(), spotLights.end(), cb.spotLights);
-    D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferLightPerObject.Get(), 0, nullptr, &cb, 0, 0);
-
-    ID3D11Buffer* cbs[1] = { constantBufferLightPerObject.Get() };
-    D3DManager::getInstance()->GetContext()->PSSetConstantBuffers(CB_LightPerObject, 1, cbs);
+    packet.addUpload(buffer, cb);
 }
 
 
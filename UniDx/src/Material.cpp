@@ -4,6 +4,7 @@
 #include <UniDx/D3DManager.h>
 #include <UniDx/Texture.h>
 #include <UniDx/ConstantBuffer.h>
+#include <UniDx/FramePacket.h>
 
 
 namespace UniDx{
@@ -60,7 +61,6 @@ namespace
 // コンストラクタ
 // -----------------------------------------------------------------------------
 Material::Material() :
-    Object([this]() { return shader->name; }),
     shader(make_shared<Shader>()),
     color(1, 1, 1, 1),
     mainTexture(
@@ -124,6 +124,31 @@ bool Material::SetBytes(StringId name, const void* data, uint32_t size)
 }
 
 
+// -----------------------------------------------------------------------------
+// 変更されたマテリアル変数を描画用のパケットに写す
+// -----------------------------------------------------------------------------
+void Material::extract(FramePacket& packet)
+{
+    // 複数のRendererで共有されていても１フレームに１度だけ
+    if (extractedSerial_ == packet.getSerial()) return;
+    extractedSerial_ = packet.getSerial();
+
+    if(cbStaging.size() != shader->getCBPerMaterialSize())
+    {
+        createConstantBuffer();
+    }
+
+    // カラーを設定
+    SetColor(StringId::intern("baseColor"), color);
+
+    if(dirty)
+    {
+        packet.addUpload(constantBufferPerMaterial, cbStaging.data(), cbStaging.size());
+        dirty = false;
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // レンダリング用にデバイスへ設定
 // -----------------------------------------------------------------------------
@@ -154,24 +179,7 @@ bool Material::bind()
     // ラスタライザステート
     D3DManager::getInstance()->GetContext()->RSSetState(rasterizerState.Get());
 
-    // 定数バッファ更新
-    if(cbStaging.size() != shader->getCBPerMaterialSize())
-    {
-        createConstantBuffer();
-    }
-
-    // カラーを設定
-    SetColor(StringId::intern("baseColor"), color);
-
-    if(dirty)
-    {
-        if(cbStaging.size() > 0)
-        {
-            D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferPerMaterial.Get(), 0, nullptr, cbStaging.data(), 0, 0);
-        }
-        dirty = false;
-    }
-
+    // 定数バッファ（内容は extract() でパケットから転送済み）
     ID3D11Buffer* cbs[1] = { constantBufferPerMaterial.Get() };
     D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(CB_PerMaterial, 1, cbs);
     D3DManager::getInstance()->GetContext()->PSSetConstantBuffers(CB_PerMaterial, 1, cbs);
@@ -202,7 +210,10 @@ void Material::OnEnable()
 
     dsDesc.StencilEnable = FALSE;
 
-    D3DManager::getInstance()->GetDevice()->CreateDepthStencilState(&dsDesc, &depthStencilState);
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateDepthStencilState(&dsDesc, &depthStencilState);
+    }
 
     // ブレンドステート作成
     setBlendMode(blendMode);
@@ -217,7 +228,10 @@ void Material::OnEnable()
     D3D11_RASTERIZER_DESC desc = {};
     desc.FillMode = D3D11_FILL_SOLID;
     desc.CullMode = cullMode;
-    D3DManager::getInstance()->GetDevice()->CreateRasterizerState(&desc, &rasterizerState);
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateRasterizerState(&desc, &rasterizerState);
+    }
 }
 
 
@@ -232,7 +246,10 @@ void Material::createConstantBuffer()
     desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     desc.CPUAccessFlags = 0;
     desc.Usage = D3D11_USAGE_DEFAULT;
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBufferPerMaterial.GetAddressOf());
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBuffer(&desc, nullptr, constantBufferPerMaterial.GetAddressOf());
+    }
 
     dirty = true;
 }
@@ -247,7 +264,10 @@ void Material::setBlendMode(BlendMode e)
     blendDesc.AlphaToCoverageEnable = FALSE;
     blendDesc.IndependentBlendEnable = FALSE;
     blendDesc.RenderTarget[0] = blendModeRTDesc[e];
-    D3DManager::getInstance()->GetDevice()->CreateBlendState(&blendDesc, &blendState);
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBlendState(&blendDesc, &blendState);
+    }
 }
 
 
@@ -77,7 +77,7 @@ void SubMesh::render() const
 }
 
 
-void Mesh::render(std::span<const std::shared_ptr<Material>> materials) const
+void Mesh::render(std::span<const std::shared_ptr<SubMesh>> submesh, std::span<const std::shared_ptr<Material>> materials)
 {
     for (int i = 0; i < submesh.size(); ++i)
     {
@@ -3,10 +3,15 @@
 
 #include <numbers>
 #include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <UniDx/JobSystem.h>
+#include <UniDx/Profiler.h>
 
 #include <UniDx/Collider.h>
 #include <UniDx/Rigidbody.h>
 #include <PhysicsGrid.h>
+#include <PhysicsGridTuner.h>
 
 #define UNIDX_PHYSICS_USE_GRID true
 
@@ -16,9 +21,16 @@ namespace UniDx
     using namespace std;
 
     // 初期化
+    // 無効になった枠を再利用するときも呼ばれるので、前のコライダーの状態を全て消す
     void PhysicsShape::initialize(Collider* collider)
     {
         collider_ = collider;
+        actor = nullptr; // 前のアクタは登録解除で削除されていることがある
+        static_ = false;
+        collisions_.clear();
+        collisionsNew_.clear();
+        triggers_.clear();
+        triggersNew_.clear();
         // moveBounds
     }
 
@@ -60,7 +72,7 @@ namespace UniDx
         // 衝突コールバック
         for (const auto& collision : collisionsNew_)
         {
-            const auto& inOld = std::ranges::find_if(collisions_, [collision](auto i) {return i.collider == collision.collider; });
+            const auto& inOld = std::ranges::find_if(collisions_, [&collision](const Collision& i) {return i.collider == collision.collider; });
             if (inOld == collisions_.end())
             {
                 // 以前のリストに含まれていない＝新規
@@ -79,7 +91,7 @@ namespace UniDx
         }
 
         // 新しいリストになくて古いほうに残っている=離れた
-        for (auto col : collisions_)
+        for (const auto& col : collisions_)
         {
             getCollider()->gameObject->onCollisionExit(col);
             if (!isValid()) return;
@@ -91,35 +103,123 @@ namespace UniDx
     }
 
     // コンストラクタ
-    Physics::Physics()
+    PhysicsWorld::PhysicsWorld()
     {
         // 毎フレームクリアされるデータはできるだけ再利用する
         // 最初にある程度の数を予約
         potentialPairs.reserve(128);
         potentialPairsTrigger.reserve(128);
-#if UNIDX_PHYSICS_USE_GRID
-        physicsGrid = make_unique<PhysicsGrid>(MakeMemberAction(this, &Physics::checkBounds));
+        physicsGrid = make_unique<PhysicsGrid>(MakeMemberAction(this, &PhysicsWorld::checkBounds));
+        gridTuner = make_unique<PhysicsGridTuner>();
+        broadphase_.useGrid = UNIDX_PHYSICS_USE_GRID;
+    }
+
+    // デストラクタ
+    PhysicsWorld::~PhysicsWorld()
+    {
+    }
+
+    // ブロードフェーズのパラメータを設定
+    void PhysicsWorld::setBroadphaseSettings(const BroadphaseSettings& settings)
+    {
+        broadphase_ = settings;
+        gridTuner->reset(); // 自動調整はこの値から始める
+    }
+
+    // 複数のワールドを並列にシミュレート
+    // コールバックはオブジェクトの破棄やプールへの返却、Transformの遅延更新を行うことがあり
+    // ワールドをまたいで状態を共有するので、並列に計算した後にメインスレッドで順に呼ぶ
+    void PhysicsWorld::SimulateParallel(std::span<PhysicsWorld* const> worlds, float step)
+    {
+        // 並列に親の行列を遅延計算しないよう、先にまとめて更新しておく
+        TransformHierarchy::getInstance()->update();
+
+        // 剛体の位置を設定するときに読む親の逆行列も、ここで計算しておく
+        for (PhysicsWorld* world : worlds)
+        {
+            for (auto& act : world->physicsActors)
+            {
+                if (!act.second.isValid()) continue;
+                if (Transform* parent = act.first->transform->parent) parent->worldToLocalMatrix();
+            }
+        }
+
+#ifdef _DEBUG
+        // 別のワールドで動く剛体を祖先に持つと、その行列を２つのスレッドで計算することになる
+        {
+            std::unordered_map<const Transform*, const PhysicsWorld*> bodies;
+            for (PhysicsWorld* world : worlds)
+            {
+                for (auto& act : world->physicsActors)
+                {
+                    if (act.second.isValid() && !act.first->transform->isStatic()) bodies.emplace(act.first->transform, world);
+                }
+            }
+            for (auto& [body, world] : bodies)
+            {
+                for (const Transform* p = body->parent; p != nullptr; p = p->parent)
+                {
+                    auto it = bodies.find(p);
+                    assert((it == bodies.end() || it->second == world) && "別のワールドで動く剛体の子孫は並列に計算できない");
+                }
+            }
+        }
 #endif
 
+        // 判定と解決はワールド内で完結するので並列に実行できる
+        JobSystem::parallelFor(worlds.size(), 1,
+            [worlds, step](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    UNIDX_PROFILE_ZONE("PhysicsWorld.simulate");
+                    worlds[i]->stepPositionCorrection(step);
+                }
+            });
+
+        for (PhysicsWorld* world : worlds)
+        {
+            world->dispatchCallbacks();
+        }
+
+        // 形状のコピーはワールドごとに独立しているので再び並列に行う
+        JobSystem::parallelFor(worlds.size(), 1,
+            [worlds](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    UNIDX_PROFILE_ZONE("PhysicsWorld.publishSnapshot");
+                    worlds[i]->publishSnapshot();
+                }
+            });
     }
 
     // Rigidbodyを登録
-    void Physics::registerRigidbody(Rigidbody* rigidbody)
+    void PhysicsWorld::registerRigidbody(Rigidbody* rigidbody)
     {
         PhysicsActor temp(rigidbody);
+        temp.initLod(stepCount, actorSerial++);
         physicsActors.insert(std::make_pair(rigidbody, temp));
     }
 
 
     // 3D形状を持ったコライダーの登録を解除
-    void Physics::unregisterRigidbody(Rigidbody* rigidbody)
+    void PhysicsWorld::unregisterRigidbody(Rigidbody* rigidbody)
     {
-        physicsActors.erase(rigidbody);
+        auto it = physicsActors.find(rigidbody);
+        if (it == physicsActors.end()) return;
+
+        // 削除するアクタを指しているShapeは次のステップで探し直す
+        for (auto& shape : physicsShapes)
+        {
+            if (shape.actor == &it->second) shape.actor = nullptr;
+        }
+        physicsActors.erase(it);
     }
 
 
     // 3D形状を持ったコライダーを登録
-    void Physics::register3d(Collider* collider)
+    void PhysicsWorld::register3d(Collider* collider)
     {
         for (size_t i = 0; i < physicsShapes.size(); ++i)
         {
@@ -141,7 +241,7 @@ namespace UniDx
 
 
     // 3D形状を持ったコライダーの登録を解除
-    void Physics::unregister3d(Collider* collider)
+    void PhysicsWorld::unregister3d(Collider* collider)
     {
         for (size_t i = 0; i < physicsShapes.size(); ++i)
         {
@@ -154,14 +254,32 @@ namespace UniDx
     }
 
 
+    // rigidbody についている Collider のうち、登録先が変わったものを登録し直す
+    void PhysicsWorld::updateColliderWorlds(Rigidbody* rigidbody)
+    {
+        for (size_t i = 0; i < physicsShapes.size(); ++i)
+        {
+            Collider* collider = physicsShapes[i].getCollider();
+            if (collider != nullptr && collider->attachedRigidbody == rigidbody)
+            {
+                collider->updatePhysicsWorld();
+            }
+        }
+    }
+
+
     // 物理計算準備
-    void Physics::initializeSimulate(float step)
+    void PhysicsWorld::initializeSimulate(float step)
     {
         // 無効になっているものをvectorから削除
         for (auto it = physicsActors.begin(); it != physicsActors.end();)
         {
             if (!it->second.isValid())
             {
+                for (auto& shape : physicsShapes)
+                {
+                    if (shape.actor == &it->second) shape.actor = nullptr;
+                }
                 it = physicsActors.erase(it);
             }
             else
@@ -184,133 +302,267 @@ namespace UniDx
         }
 
         // Rigidbodyの更新
+        // LODによってこのステップで計算しないものは止まっているものとして扱う
         for (auto& act : physicsActors)
         {
-            act.second.getRigidbody()->physicsUpdate();
             act.second.initCorrectBounds();
+            float actorStep = updateLod(act.second, step);
+            if (actorStep > 0.0f)
+            {
+                act.second.getRigidbody()->physicsUpdate(actorStep);
+            }
         }
 
         // Shapeの移動Boundsと次に当たるコライダーを初期化
         for (auto& shape : physicsShapes)
         {
-            shape.initOtherNew();
-
-            Bounds bounds = shape.getCollider()->getBounds();
-            auto rb = shape.getCollider()->attachedRigidbody;
-            if (rb != nullptr)
-            {
-                bounds.Encapsulate(bounds.min() + rb->getMoveVector(step));
-                bounds.Encapsulate(bounds.max() + rb->getMoveVector(step));
-            }
-            shape.moveBounds = bounds;
             Rigidbody* r = shape.getCollider()->attachedRigidbody;
             if (r != nullptr)
             {
+                // Rigidbody が無効か別のワールドにあるときは、見つかるまで動かないコライダーとして扱う
                 if (shape.actor == nullptr)
                 {
-                    shape.actor = &physicsActors.at(r);
+                    auto it = physicsActors.find(r);
+                    shape.actor = it != physicsActors.end() ? &it->second : nullptr;
                 }
             }
             else
             {
                 shape.actor = nullptr;
             }
+
+            // 静的かどうかは毎ステップ確認する
+            const bool wasStatic = shape.isStatic();
+            shape.setStatic(shape.getCollider()->transform->isStatic());
+
+            // 計算しないShapeは前回の判定結果を保持する
+            if (shape.isStepping())
+            {
+                shape.initOtherNew();
+            }
+
+            // 静的なShapeの範囲は変わらないので求め直さない
+            if (wasStatic && shape.isStatic()) continue;
+
+            Bounds bounds = shape.getCollider()->getBounds();
+            if (shape.actor != nullptr && shape.actor->isSimulating())
+            {
+                Vector3 move = r->getMoveVector(shape.actor->getLodStep());
+                bounds.Encapsulate(bounds.min() + move);
+                bounds.Encapsulate(bounds.max() + move);
+            }
+            shape.moveBounds = bounds;
         }
     }
 
 
+    // 物理LODの段階を更新し、このステップで計算するならそのステップ時間を返す
+    float PhysicsWorld::updateLod(PhysicsActor& actor, float step)
+    {
+        Rigidbody* rb = actor.getRigidbody();
+
+        // 静的なRigidbodyは移動も位置の書き戻しもしない
+        if (rb->transform->isStatic())
+        {
+            return actor.holdStep(stepCount);
+        }
+
+        if (!lod.enabled || !rb->useSimulationLod)
+        {
+            actor.setLodLevel(0);
+        }
+        else if ((stepCount + actor.getLodPhase()) % std::max(lod.reassignInterval, 1u) == 0)
+        {
+            // 距離による再計算は毎ステップ一部のアクタだけ行う
+            float sqrDist = SqrDistance(rb->position, lod.focus);
+            if (sqrDist >= lod.quarterRateDistance * lod.quarterRateDistance)
+            {
+                actor.setLodLevel(2);
+            }
+            else if (sqrDist >= lod.halfRateDistance * lod.halfRateDistance)
+            {
+                actor.setLodLevel(1);
+            }
+            else
+            {
+                actor.setLodLevel(0);
+            }
+        }
+        return actor.beginStep(stepCount, step);
+    }
+
+
     // 位置補正法（射影法）による物理計算のシミュレート
-    void Physics::simulatePositionCorrection(float step)
+    void PhysicsWorld::simulatePositionCorrection(float step)
     {
-        auto start = std::chrono::system_clock::now(); // 開始時刻を記録
+        UNIDX_PROFILE_ZONE("PhysicsWorld.simulate");
+
+        stepPositionCorrection(step);
+        dispatchCallbacks();
+
+        // 次のステップまでの問い合わせ用に形状を公開
+        {
+            UNIDX_PROFILE_ZONE("PhysicsWorld.publishSnapshot");
+            publishSnapshot();
+        }
+    }
+
 
+    // 位置補正法による判定と解決。コールバックは呼ばず、判定結果を Shape に溜めておく
+    void PhysicsWorld::stepPositionCorrection(float step)
+    {
+        using clock = std::chrono::steady_clock;
+
+        ++stepCount;
         initializeSimulate(step);
 
-        static double totalTime = 0.0;
-        static double totalInsert = 0.0;
-        static int timeCount = 0;
+        auto broadStart = clock::now(); // 開始時刻を記録
 
         // まずは当たりそうなペアをAABBで判定して抽出
-        potentialPairs.clear();
-        potentialPairsTrigger.clear();
-
-#if UNIDX_PHYSICS_USE_GRID
-        physicsGrid->update(physicsShapes);
-        auto insert = std::chrono::system_clock::now(); // 終了時刻を記録
-        totalInsert += std::chrono::duration_cast<std::chrono::microseconds>(insert - start).count() * 0.001;
-        physicsGrid->gatherPairs();
-#else
-        for (size_t i = 0; i < physicsShapes.size(); ++i)
         {
-            for (size_t j = i + 1; j < physicsShapes.size(); ++j)
+            UNIDX_PROFILE_ZONE("PhysicsWorld.broadphase");
+            potentialPairs.clear();
+            potentialPairsTrigger.clear();
+
+            if (broadphase_.useGrid)
             {
-                checkBounds(&physicsShapes[i], &physicsShapes[j]);
+                physicsGrid->nodeDivide = broadphase_.nodeDivide;
+                physicsGrid->maxPerCell = broadphase_.maxPerCell;
+                physicsGrid->update(physicsShapes);
+                physicsGrid->gatherPairs();
+            }
+            else
+            {
+                for (size_t i = 0; i < physicsShapes.size(); ++i)
+                {
+                    for (size_t j = i + 1; j < physicsShapes.size(); ++j)
+                    {
+                        checkBounds(&physicsShapes[i], &physicsShapes[j]);
+                    }
+                }
             }
         }
-#endif
-        auto end = std::chrono::system_clock::now(); // 終了時刻を記録
-        std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        totalTime += elapsed.count() * 0.001;
-        timeCount++;
-        if (timeCount % 100 == 0)
-        {
-//            Debug::Log(totalInsert);
-//            Debug::Log(totalTime);
-            totalInsert = 0.0;
-            totalTime = 0.0;
-            timeCount = 0;
-        }
+        auto broadEnd = clock::now(); // 終了時刻を記録
 
         // 先に位置を更新する
-        for (auto& act : physicsActors)
         {
-            act.second.getRigidbody()->applyMove(step);
+            UNIDX_PROFILE_ZONE("PhysicsWorld.integrate");
+            for (auto& act : physicsActors)
+            {
+                if (act.second.isSimulating())
+                {
+                    act.second.getRigidbody()->applyMove(act.second.getLodStep());
+                }
+            }
         }
 
-        // トリガーチェックする
-        for (auto& pair : potentialPairsTrigger)
+        auto narrowStart = clock::now();
+        size_t contactPairs = 0;
         {
-            if (pair.first->getCollider()->intersects(pair.second->getCollider()))
+            UNIDX_PROFILE_ZONE("PhysicsWorld.narrowphase");
+
+            // トリガーチェックする
+            // 結果はこのステップで計算するShapeにだけ記録する
+            for (auto& pair : potentialPairsTrigger)
             {
-                pair.first->addTrigger(pair.second->getCollider());
-                pair.second->addTrigger(pair.first->getCollider());
+                if (pair.first->getCollider()->intersects(pair.second->getCollider()))
+                {
+                    ++contactPairs;
+                    if (pair.first->isStepping()) pair.first->addTrigger(pair.second->getCollider());
+                    if (pair.second->isStepping()) pair.second->addTrigger(pair.first->getCollider());
+                }
             }
-        }
 
-        // 衝突をチェックする
-        for (auto& pair : potentialPairs)
-        {
-            if (pair.first->getCollider()->checkIntersect(pair.second->getCollider(), pair.first->actor, pair.second->actor))
+            // 衝突をチェックする
+            for (auto& pair : potentialPairs)
             {
-                Collision ca;
-                ca.collider = pair.second->getCollider();
-                pair.first->addCollide(ca);
+                Collision collision;
+                if (pair.first->getCollider()->checkIntersect(pair.second->getCollider(), pair.first->actor, pair.second->actor, &collision))
+                {
+                    ++contactPairs;
+                    // 接触点は固定長配列なのでヒープ確保なしでコピーできる
+                    if (pair.first->isStepping())
+                    {
+                        pair.first->addCollide(collision);
+                    }
 
-                Collision cb;
-                cb.collider = pair.first->getCollider();
-                pair.second->addCollide(cb);
+                    if (pair.second->isStepping())
+                    {
+                        pair.second->addCollide(collision.reversed(pair.first->getCollider()));
+                    }
+                }
             }
         }
 
+        // ブロードフェーズと詳細判定の処理時間、候補ペアに対する実際の接触の割合からパラメータを調整
+        if (autoTuneBroadphase)
+        {
+            auto narrowEnd = clock::now();
+            double ms = std::chrono::duration<double, std::milli>((broadEnd - broadStart) + (narrowEnd - narrowStart)).count();
+            gridTuner->addSample(ms, potentialPairs.size() + potentialPairsTrigger.size(), contactPairs, physicsShapes.size(), broadphase_);
+        }
+
         // 衝突で生じた補正を含めて位置と速度を解決する
-        for (auto& act : physicsActors)
         {
-            act.second.getRigidbody()->solveCorrection(act.second.getCorrectPositionBounds(), act.second.getCorrectVelocityBounds());
+            UNIDX_PROFILE_ZONE("PhysicsWorld.solve");
+            for (auto& act : physicsActors)
+            {
+                if (act.second.isSimulating())
+                {
+                    act.second.getRigidbody()->solveCorrection(act.second.getCorrectPositionBounds(), act.second.getCorrectVelocityBounds());
+                }
+            }
         }
+    }
 
-        // OnTrigger～, OnCollision～等のコールバックを呼び出す
-        // TODO: 当たったRigidbodyがついているGameObjectでも呼び出す
+
+    // OnTrigger～, OnCollision～等のコールバックを呼び出す
+    // メインスレッドから呼ぶこと
+    // TODO: 当たったRigidbodyがついているGameObjectでも呼び出す
+    void PhysicsWorld::dispatchCallbacks()
+    {
+        UNIDX_PROFILE_ZONE("PhysicsWorld.callbacks");
         for (auto& shape : physicsShapes)
         {
-            if (shape.isValid())
+            if (shape.isValid() && shape.isStepping())
             {
                 shape.collideCallback();
             }
         }
     }
 
-    void Physics::checkBounds(PhysicsShape* shape1, PhysicsShape* shape2)
+
+    // 現在の形状をコピーしてスナップショットとして公開
+    void PhysicsWorld::publishSnapshot()
     {
+        // 公開中でないほうのバッファに作る。前回公開したものをまだ読んでいるスレッドがあれば新しく確保
+        auto& buffer = snapshotBuffers_[snapshotBack_];
+        if (buffer == nullptr || buffer.use_count() > 1)
+        {
+            buffer = make_shared<PhysicsSnapshot>();
+        }
+
+        buffer->stepCount = stepCount;
+        buffer->shapes.clear();
+        buffer->shapes.reserve(physicsShapes.size());
+        for (const auto& shape : physicsShapes)
+        {
+            if (!shape.isValid()) continue; // コールバック中に無効になったもの
+            shape.getCollider()->getShapeData(buffer->shapes.emplace_back());
+        }
+
+        snapshot_.store(buffer);
+        snapshotBack_ ^= 1;
+    }
+
+    void PhysicsWorld::checkBounds(PhysicsShape* shape1, PhysicsShape* shape2)
+    {
+        // どちらもこのステップで計算しない場合は判定不要
+        if (!shape1->isStepping() && !shape2->isStepping()) return;
+
+        // 静的なもの同士は動かないので判定不要
+        if (shape1->isStatic() && shape2->isStatic()) return;
+
         if (shape1->moveBounds.Intersects(shape2->moveBounds))
         {
             auto rbA = shape1->getCollider()->attachedRigidbody;
@@ -334,7 +586,7 @@ namespace UniDx
     }
 
     // 物理計算のシミュレート（未完成）
-    void Physics::simulate(float step)
+    void PhysicsWorld::simulate(float step)
     {
         initializeSimulate(step);
 
@@ -382,7 +634,7 @@ namespace UniDx
     }
 
 
-    void Physics::solveVelocityConstraint(Rigidbody* A, Rigidbody* B, const ContactManifold& m)
+    void PhysicsWorld::solveVelocityConstraint(Rigidbody* A, Rigidbody* B, const ContactManifold& m)
     {
         const float restitution = 0.2f;   // 反発係数
 
@@ -392,13 +644,13 @@ namespace UniDx
     }
 
 
-    void Physics::solvePositionConstraint(Rigidbody* A, Rigidbody* B, const ContactManifold& m)
+    void PhysicsWorld::solvePositionConstraint(Rigidbody* A, Rigidbody* B, const ContactManifold& m)
     {
 
     }
 
     // Raycast
-    bool Physics::Raycast(Vector3 origin, Vector3 direction, float maxDistance,
+    bool PhysicsWorld::Raycast(Vector3 origin, Vector3 direction, float maxDistance,
         RaycastHit* hitInfo, std::function<bool(const Collider*)> filter)
     {
         // 無効な方向や負の距離はヒットしない
@@ -437,4 +689,67 @@ namespace UniDx
         return hitAny;
     }
 
+
+    // スナップショットに対する Raycast
+    bool PhysicsSnapshot::Raycast(Vector3 origin, Vector3 direction, float maxDistance,
+        RaycastHit* hitInfo, std::function<bool(const PhysicsShapeData&)> filter) const
+    {
+        // 無効な方向や負の距離はヒットしない
+        const float eps = 1e-6f;
+        if (maxDistance <= 0.0f) return false;
+        if (fabs(direction.x) < eps && fabs(direction.y) < eps && fabs(direction.z) < eps) return false;
+
+        bool hitAny = false;
+        float bestT = std::numeric_limits<float>::infinity();
+
+        for (const auto& shape : shapes)
+        {
+            if (filter && !filter(shape)) continue; // フィルタで除外
+
+            RaycastHit localHit;
+            bool hit = shape.type == PhysicsShapeType_Sphere ?
+                SphereCollider::RaycastSphere(shape.center, shape.radius, origin, direction, maxDistance, &localHit) :
+                AABBCollider::RaycastBounds(shape.bounds, origin, direction, maxDistance, &localHit);
+            if (hit && localHit.distance < bestT)
+            {
+                bestT = localHit.distance;
+                if (hitInfo != nullptr)
+                {
+                    *hitInfo = localHit;
+                    hitInfo->collider = shape.collider;
+                }
+                hitAny = true;
+            }
+        }
+
+        return hitAny;
+    }
+
+
+    // スナップショットに対して球と重なっている形状を探す
+    size_t PhysicsSnapshot::OverlapSphere(Vector3 center, float radius, std::vector<Collider*>& results) const
+    {
+        size_t count = 0;
+        for (const auto& shape : shapes)
+        {
+            bool overlap = false;
+            if (shape.type == PhysicsShapeType_Sphere)
+            {
+                float r = radius + shape.radius;
+                overlap = SqrDistance(center, shape.center) <= r * r;
+            }
+            else
+            {
+                overlap = shape.bounds.SqrDistance(center) <= radius * radius;
+            }
+
+            if (overlap)
+            {
+                results.push_back(shape.collider);
+                ++count;
+            }
+        }
+        return count;
+    }
+
 } // UniDx
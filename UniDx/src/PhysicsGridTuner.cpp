@@ -0,0 +1,160 @@
+﻿#include "pch.h"
+#include <PhysicsGridTuner.h>
+
+#include <algorithm>
+#include <array>
+
+
+namespace UniDx
+{
+    using namespace std;
+
+    namespace
+    {
+        // 試す近傍の種類
+        enum Move
+        {
+            Move_FinerDivide,   // nodeDivide を増やす
+            Move_FinerCell,     // maxPerCell を減らす
+            Move_CoarserDivide, // nodeDivide を減らす
+            Move_CoarserCell,   // maxPerCell を増やす
+            Move_ToggleGrid,    // グリッドと総当たりを切り替える
+            Move_Count
+        };
+
+        // 候補ペアが実際の接触よりこの倍率以上多ければ、セルが粗すぎると判断して細かくする方向から試す
+        constexpr double coarseRatio = 4.0;
+
+        bool equals(const PhysicsWorld::BroadphaseSettings& a, const PhysicsWorld::BroadphaseSettings& b)
+        {
+            return a.useGrid == b.useGrid && a.nodeDivide == b.nodeDivide && a.maxPerCell == b.maxPerCell;
+        }
+    }
+
+
+    // 1ステップ分の計測結果を追加
+    bool PhysicsGridTuner::addSample(double milliseconds, size_t candidatePairs, size_t contactPairs, size_t shapeCount, Params& params)
+    {
+        if (phase_ == Phase::Settled)
+        {
+            // Shapeの数が25%以上変わったら調整をやり直す
+            if (shapeCount * 4 <= shapeCount_ * 5 && shapeCount * 5 >= shapeCount_ * 4) return false;
+            reset();
+        }
+
+        if (count_ == 0) shapeCount_ = shapeCount;
+        totalTime_ += milliseconds;
+        totalCandidates_ += candidatePairs;
+        totalContacts_ += contactPairs;
+        if (++count_ < windowSize) return false;
+
+        const double cost = totalTime_ / count_;
+        const double ratio = double(totalCandidates_) / double(std::max<size_t>(totalContacts_, 1));
+        clearWindow();
+
+        if (phase_ == Phase::Trial)
+        {
+            // 速くなっていれば採用し、この計測を新しい基準にして次の周を始める
+            if (cost < baselineCost_ * acceptRatio)
+            {
+                baselineCost_ = cost;
+                baselineParams_ = params;
+                return beginRound(ratio, params);
+            }
+
+            // 不採用なら基準は測り直さず、この周の次の近傍を試す
+            return tryNextCandidate(params);
+        }
+
+        // 現在のパラメータの計測が終わったので、近傍を試す
+        baselineCost_ = cost;
+        baselineParams_ = params;
+        return beginRound(ratio, params);
+    }
+
+
+    // 基準のパラメータから試す近傍を決めて、最初の近傍を試す
+    bool PhysicsGridTuner::beginRound(double ratio, Params& params)
+    {
+        candidateCount_ = buildCandidates(baselineParams_, ratio, candidates_);
+        candidateIndex_ = 0;
+        return tryNextCandidate(params);
+    }
+
+
+    // この周の次の近傍を試す。全て不採用なら基準に戻して収束
+    // params を変更したとき true
+    bool PhysicsGridTuner::tryNextCandidate(Params& params)
+    {
+        if (candidateIndex_ >= candidateCount_)
+        {
+            phase_ = Phase::Settled;
+            const bool changed = !equals(params, baselineParams_);
+            params = baselineParams_;
+            return changed;
+        }
+
+        params = candidates_[candidateIndex_++];
+        phase_ = Phase::Trial;
+        return true;
+    }
+
+
+    // current の近傍を試す順に列挙して、その数を返す
+    int PhysicsGridTuner::buildCandidates(const Params& current, double ratio, array<Params, CandidateMax>& out) const
+    {
+        static_assert(CandidateMax >= Move_Count);
+
+        // 候補ペアが多すぎるときは細かくする方向から試す
+        static constexpr array<Move, Move_Count> finerFirst = { Move_FinerDivide, Move_FinerCell, Move_CoarserDivide, Move_CoarserCell, Move_ToggleGrid };
+        static constexpr array<Move, Move_Count> coarserFirst = { Move_CoarserDivide, Move_CoarserCell, Move_FinerDivide, Move_FinerCell, Move_ToggleGrid };
+        const auto& order = ratio > coarseRatio ? finerFirst : coarserFirst;
+
+        // 範囲内に収まる近傍を列挙
+        int candidateCount = 0;
+        for (Move move : order)
+        {
+            Params p = current;
+            switch (move)
+            {
+            case Move_FinerDivide:   p.nodeDivide = std::min(current.nodeDivide * 2, NodeDivideMax); break;
+            case Move_FinerCell:     p.maxPerCell = std::max(current.maxPerCell / 2, MaxPerCellMin); break;
+            case Move_CoarserDivide: p.nodeDivide = std::max(current.nodeDivide / 2, NodeDivideMin); break;
+            case Move_CoarserCell:   p.maxPerCell = std::min(current.maxPerCell * 2, MaxPerCellMax); break;
+            case Move_ToggleGrid:
+                // 総当たりはShapeが少ないときだけ試す
+                if (current.useGrid && shapeCount_ > BruteForceShapeMax) continue;
+                p.useGrid = !current.useGrid;
+                break;
+            default: break;
+            }
+
+            // 総当たりのときはグリッドのパラメータは意味がない
+            if (!current.useGrid && move != Move_ToggleGrid) continue;
+            if (equals(p, current)) continue;
+            out[candidateCount++] = p;
+        }
+        return candidateCount;
+    }
+
+
+    // 計測をやり直す
+    void PhysicsGridTuner::reset()
+    {
+        phase_ = Phase::Baseline;
+        candidateCount_ = 0;
+        candidateIndex_ = 0;
+        clearWindow();
+    }
+
+
+    // 計測窓をクリア
+    void PhysicsGridTuner::clearWindow()
+    {
+        count_ = 0;
+        totalTime_ = 0.0;
+        totalCandidates_ = 0;
+        totalContacts_ = 0;
+    }
+
+}
@@ -2,6 +2,7 @@
 #include <UniDx/PlayerLoop.h>
 
 #include <chrono>
+#include <algorithm>
 
 #include <UniDx/D3DManager.h>
 #include <UniDx/SceneManager.h>
@@ -10,6 +11,10 @@
 #include <UniDx/LightManager.h>
 #include <UniDx/Input.h>
 #include <UniDx/Canvas.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/EntityManager.h>
+#include <UniDx/Coroutine.h>
+#include <UniDx/Profiler.h>
 
 using namespace std;
 using namespace UniDx;
@@ -22,12 +27,24 @@ namespace UniDx
 // -----------------------------------------------------------------------------
 void PlayerLoop::Initialize(HWND hWnd)
 {
+    // ワーカースレッドを起動
+    JobSystem::create();
+
+    // Transformの配列を作成（GameObjectより先に必要）
+    TransformHierarchy::create();
+
     // Direct3Dインスタンス作成
     D3DManager::create();
 
     // Direct3D初期化
     D3DManager::getInstance()->Initialize(hWnd, 1280, 720);
 
+    // 描画スレッドを起動（以降、D3Dのコンテキストは描画スレッドだけが使う）
+    if (frameLatency > 0)
+    {
+        renderThread_ = std::make_unique<RenderThread>(frameLatency);
+    }
+
     // 入力の初期化
     Input::initialize();
 
@@ -37,6 +54,9 @@ void PlayerLoop::Initialize(HWND hWnd)
     // ライトマネージャのインスタンス作成
     LightManager::create();
 
+    // コルーチンのスケジューラ作成
+    CoroutineScheduler::create();
+
     // シーンマネージャのインスタンス作成
     SceneManager::create();
 }
@@ -67,6 +87,8 @@ int PlayerLoop::MainLoop()
     Time::Start();
     double restFixedUpdateTime = 0.0f;
 
+    Profiler::setThreadName("Main");
+
     // デフォルトのシーン作成
     createScene();
 
@@ -87,13 +109,12 @@ int PlayerLoop::MainLoop()
             }
         }
 
+        UNIDX_PROFILE_ZONE("PlayerLoop.frame");
+
         // 経過時間計測
         using clock = std::chrono::steady_clock;
         auto start = clock::now();
 
-        // 画面を塗りつぶす
-        D3DManager::getInstance()->Clear(0.35f, 0.55f, 0.9f, 1.0f);
-
         Time::SetDeltaTimeFixed(); // Unity同様、FixedUpdate()では deltaTime と fixedDeltaTime が同じ
 
         while (restFixedUpdateTime > Time::fixedDeltaTime)
@@ -101,6 +122,9 @@ int PlayerLoop::MainLoop()
             // 固定時間更新更新
             fixedUpdate();
 
+            // FixedUpdate()で動かしたTransformの行列を更新
+            updateTransforms();
+
             // 物理計算
             physics();
 
@@ -115,18 +139,24 @@ int PlayerLoop::MainLoop()
         // 更新処理
         update();
 
+        // 並列更新処理（記録された変更はこの中で実行される）
+        parallelUpdate();
+
+        // エンティティのシステム
+        updateEntities();
+
         // 後更新処理
         lateUpdate();
 
-        // 描画処理
+        // 描画前に全Transformの行列を更新
+        updateTransforms();
+
+        // 描画情報を抽出して描画を依頼（画面への表示まで描画スレッドで行う）
         render();
 
         // 削除チェック
         checkDestroy();
 
-        // バックバッファの内容を画面に表示
-        D3DManager::getInstance()->Present();
-
         // 時間計算
         double deltaTime = std::chrono::duration<double>(clock::now() - start).count();
         restFixedUpdateTime += deltaTime;
@@ -144,23 +174,34 @@ int PlayerLoop::MainLoop()
 // 固定時間更新更新
 void PlayerLoop::fixedUpdate()
 {
-    for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
-    {
-        fixedUpdate(&*it);
-    }
+    UNIDX_PROFILE_ZONE("PlayerLoop.fixedUpdate");
+    fixedUpdateList_.forEach([](Behaviour* b) { UNIDX_PROFILE_COMPONENT(b); b->FixedUpdate(); });
 }
 
 
 // 物理計算
 void PlayerLoop::physics()
 {
+    UNIDX_PROFILE_ZONE("PlayerLoop.physics");
     Physics::getInstance()->simulatePositionCorrection(Time::fixedDeltaTime);
+
+    // WaitForFixedUpdate で待っているコルーチン
+    CoroutineScheduler::getInstance()->resumeFixedUpdate();
+}
+
+
+// ダーティなTransformのワールド行列を一括更新
+void PlayerLoop::updateTransforms()
+{
+    UNIDX_PROFILE_ZONE("PlayerLoop.updateTransforms");
+    TransformHierarchy::getInstance()->update();
 }
 
 
 // 入力更新
 void PlayerLoop::input()
 {
+    UNIDX_PROFILE_ZONE("PlayerLoop.input");
     Input::update();
 }
 
@@ -168,16 +209,44 @@ void PlayerLoop::input()
 //  更新処理
 void PlayerLoop::update()
 {
+    UNIDX_PROFILE_ZONE("PlayerLoop.update");
+
     // 各オブジェクトの Start()
-    for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
-    {
-        checkStart(&*it);
-    }
+    checkStart();
 
     // 各オブジェクトの Update()
-    for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
+    updateList_.forEach([](Behaviour* b) { UNIDX_PROFILE_COMPONENT(b); b->Update(); });
+
+    // 待機の終わったコルーチンを再開
+    CoroutineScheduler::getInstance()->resumeFrame();
+}
+
+
+// 並列更新処理
+// ワーカースレッドで ParallelUpdate() を呼び、記録された構造の変更を LateUpdate() の前に実行する
+void PlayerLoop::parallelUpdate()
+{
+    if (parallelUpdateList_.size() == 0) return;
+    UNIDX_PROFILE_ZONE("PlayerLoop.parallelUpdate");
+
+    // 並列に親の行列を遅延計算しないよう、先にまとめて更新しておく
+    updateTransforms();
+
+    JobSystem* js = JobSystem::getInstance();
+    CommandBuffer::beginRecording(js != nullptr ? js->workerCount() + 1 : 1);
+    parallelUpdateList_.parallelForEach(parallelUpdateGrain, [](Behaviour* b) { UNIDX_PROFILE_COMPONENT(b); b->ParallelUpdate(); });
+    CommandBuffer::endRecording();
+}
+
+
+// エンティティのシステムを実行し、LocalToWorld とリンクしたTransformを更新する
+// EntityManager を作成していなければ何もしない
+void PlayerLoop::updateEntities()
+{
+    UNIDX_PROFILE_ZONE("PlayerLoop.updateEntities");
+    if (auto entities = EntityManager::getInstance())
     {
-        update(&*it);
+        entities->Update();
     }
 }
 
@@ -185,77 +254,150 @@ void PlayerLoop::update()
 // 後更新処理
 void PlayerLoop::lateUpdate()
 {
+    UNIDX_PROFILE_ZONE("PlayerLoop.lateUpdate");
+
     // 各コンポーネントの LateUpdate()
-    for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
-    {
-        lateUpdate(&*it);
-    }
+    lateUpdateList_.forEach([](Behaviour* b) { UNIDX_PROFILE_COMPONENT(b); b->LateUpdate(); });
 }
 
 
 // 画面の描画処理
-// Unityのようなレンダーキューには未対応で、全てのGameObjectとComponentを巡回して実行する。
+// 描画スレッドがあれば空いているパケットに抽出して描画を依頼し、なければその場で描画する
 void PlayerLoop::render()
 {
-    // ライトバッファの更新と転送
-    LightManager::getInstance()->updateLightCBuffer();
+    UNIDX_PROFILE_ZONE("PlayerLoop.render");
 
-    Camera* camera = Camera::main;
-    if (camera != nullptr)
+    if (renderThread_ != nullptr)
     {
-        // カメラ単位の定数バッファ更新
-        camera->UpdateConstantBuffer();
+        FramePacket& packet = renderThread_->acquire();
+        extract(packet);
+        renderThread_->submit(packet);
+    }
+    else
+    {
+        framePacket_.clear();
+        extract(framePacket_);
+        framePacket_.execute();
+    }
+}
 
-        // 不透明描画
-        D3DManager::getInstance()->setCurrentCurrentRenderingMode(RenderingMode_Opaque);
 
-        // 各コンポーネントの Render
-        for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
-        {
-            render(&*it, *camera);
-        }
-    
-        // 半透明描画
-        D3DManager::getInstance()->setCurrentCurrentRenderingMode(RenderingMode_Transparent);
+// 現在のシーンの描画に必要な情報をパケットに写す
+// Unityのようなレンダーキューには未対応で、有効な全てのRendererを抽出した順に描画する。
+// プールに確保したものは型ごとにメモリの順に、new で作ったものは登録順に抽出する
+void PlayerLoop::extract(FramePacket& packet)
+{
+    UNIDX_PROFILE_ZONE("PlayerLoop.extract");
+    packet.frameCount = Time::frameCount;
 
-        // 各コンポーネントの Render
-        for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
-        {
-            render(&*it, *camera);
-        }
+    // ライト
+    LightManager::getInstance()->extract(packet);
+
+    // カメラと各Renderer
+    Camera* camera = Camera::main;
+    if (camera != nullptr)
+    {
+        camera->extract(packet);
+        ComponentPoolGroup<Renderer>::instance().forEach([&packet](Renderer* r)
+            {
+                if (!r->rendering_) return;
+                UNIDX_PROFILE_COMPONENT(r);
+                r->extract(packet);
+            });
+        rendererList_.forEach([&packet](Renderer* r) { UNIDX_PROFILE_COMPONENT(r); r->extract(packet); });
     }
 
     // UI
     for (auto& it : canvas_)
     {
-        it->render();
+        it->extract(packet);
     }
 }
 
 
-// 後の更新処理
+// 削除待ちのGameObjectだけを調べて、Destroy() されたものを削除する
+// 削除の中で Destroy() されたものも、続けてこのフレームで削除する
 void PlayerLoop::checkDestroy()
 {
-    // 各コンポーネントの checkDestroy()
-    auto* scene = SceneManager::getInstance()->GetActiveScene();
-    for (int i = 0; i < scene->GetRootGameObjects().size();)
+    UNIDX_PROFILE_ZONE("PlayerLoop.checkDestroy");
+    while (!destroyQueue_.empty())
     {
-        auto& o = scene->GetRootGameObjects()[i];
-        if (! o->checkDestroy())
+        std::swap(destroyBatch_, destroyQueue_);
+        for (GameObject* o : destroyBatch_)
+        {
+            o->destroyQueued_ = false;
+        }
+
+        // 削除する前に全て調べる（先に親を削除すると、子を指すポインタが無効になるため）
+        destroyTargets_.clear();
+        for (GameObject* o : destroyBatch_)
+        {
+            // 祖先が削除されるなら一緒に削除される（ルートは削除しない）
+            bool ancestorDestroyed = false;
+            for (Transform* p = o->transform->parent; p != nullptr && !ancestorDestroyed; p = p->parent)
+            {
+                ancestorDestroyed = p->gameObject->isCalledDestroy && p->parent != nullptr;
+            }
+            if (ancestorDestroyed) continue;
+
+            if (o->isCalledDestroy && o->transform->parent != nullptr)
+            {
+                destroyTargets_.push_back(o);
+            }
+            else
+            {
+                // ルートのGameObjectは削除しない
+                o->removeDestroyedComponents();
+            }
+        }
+        destroyBatch_.clear();
+
+        // 親から外すと子孫ごと破棄される
+        for (GameObject* o : destroyTargets_)
         {
-            ++i; // 削除しないときは次
+            o->transform->SetParent(nullptr);
         }
     }
 }
 
 
+// 削除待ちに入れる
+void PlayerLoop::enqueueDestroy(GameObject* gameObject)
+{
+    if (gameObject->destroyQueued_) return;
+    gameObject->destroyQueued_ = true;
+    destroyQueue_.push_back(gameObject);
+}
+
+
+// 削除待ちから外す
+void PlayerLoop::cancelDestroy(GameObject* gameObject)
+{
+    auto it = std::find(destroyQueue_.begin(), destroyQueue_.end(), gameObject);
+    if (it != destroyQueue_.end())
+    {
+        *it = destroyQueue_.back();
+        destroyQueue_.pop_back();
+    }
+    gameObject->destroyQueued_ = false;
+}
+
+
 // 終了処理
 void PlayerLoop::finalize()
 {
+    // 描画中のフレームを描き終えてから破棄する
+    renderThread_.reset();
+    framePacket_.clear();
+
     SceneManager::destroy();
+    CoroutineScheduler::destroy(); // Behaviour の破棄で停止されるので、シーンの後に破棄する
+    EntityManager::destroy();
     LightManager::destroy();
     Physics::destroy();
     D3DManager::destroy();
+    TransformHierarchy::destroy();
+    JobSystem::destroy();
 }
 
 
@@ -275,116 +417,71 @@ void PlayerLoop::awake(GameObject* object)
 }
 
 
-void PlayerLoop::fixedUpdate(GameObject* object)
+// Start() を待っている Behaviour の Start() を呼ぶ
+// Start() の中で有効になったものも続けて呼ばれる
+void PlayerLoop::checkStart()
 {
-    // アタッチされている各コンポーネントのFixedUpdateを呼ぶ
-    for (auto& it : object->GetComponents())
-    {
-        auto behaviour = dynamic_cast<Behaviour*>(it.get());
-        if (behaviour != nullptr && behaviour->enabled)
-        {
-            behaviour->FixedUpdate();
-        }
-    }
-
-    // 子供のオブジェクトについて再帰
-    for (auto& it : object->transform->getChildGameObjects())
-    {
-        fixedUpdate(&*it);
-    }
+    startQueue_.forEach([](Behaviour* b) { b->checkStart(); });
+    startQueue_.clear();
 }
 
 
-void PlayerLoop::checkStart(GameObject* object)
+void PlayerLoop::registerCanvas(Canvas* c)
 {
-    // 自身のコンポーネントの中でStartを呼び出していないものを呼ぶ
-    for (auto& it : object->GetComponents())
-    {
-        auto behaviour = dynamic_cast<Behaviour*>(it.get());
-        if (behaviour != nullptr)
-        {
-            behaviour->checkStart();
-        }
-    }
-
-    // 子供のオブジェクトについて再帰
-    for (auto& it : object->transform->getChildGameObjects())
-    {
-        checkStart(&*it);
-    }
+    canvas_.push_back(c);
 }
 
 
-void PlayerLoop::update(GameObject* object)
+void PlayerLoop::unregisterCanvas(Canvas* c)
 {
-    // アタッチされている各コンポーネントのUpdateを呼ぶ
-    for (auto& it : object->GetComponents())
-    {
-        auto behaviour = dynamic_cast<Behaviour*>(it.get());
-        if (behaviour != nullptr && behaviour->enabled)
-        {
-            behaviour->Update();
-        }
-    }
-
-    // 子供のオブジェクトについて再帰
-    for (auto& it : object->transform->getChildGameObjects())
-    {
-        update(&*it);
-    }
+    auto it = std::find(canvas_.begin(), canvas_.end(), c);
+    if (it != canvas_.end()) canvas_.erase(it);
 }
 
 
-void PlayerLoop::lateUpdate(GameObject* object)
+// 有効になった Behaviour を実行リストに登録
+// オーバーライドされていないと分かったメソッドのリストからは外す
+void PlayerLoop::registerBehaviour(Behaviour* b, bool waitStart)
 {
-    // アタッチされている各コンポーネントのLateUpdateを呼ぶ
-    for (auto& it : object->GetComponents())
-    {
-        auto behaviour = dynamic_cast<Behaviour*>(it.get());
-        if (behaviour != nullptr && behaviour->enabled)
+    auto sync = [b](auto& list, uint8_t flag)
         {
-            behaviour->LateUpdate();
-        }
-    }
-
-    // 子供のオブジェクトについて再帰
-    for (auto& it : object->transform->getChildGameObjects())
+            if (b->loopFlags_ & flag) list.add(b);
+            else list.remove(b);
+        };
+    sync(fixedUpdateList_, BehaviourLoop_FixedUpdate);
+    sync(updateList_, BehaviourLoop_Update);
+    sync(lateUpdateList_, BehaviourLoop_LateUpdate);
+    sync(parallelUpdateList_, BehaviourLoop_ParallelUpdate);
+
+    if (waitStart)
     {
-        lateUpdate(&*it);
+        startQueue_.add(b);
     }
 }
 
 
-void PlayerLoop::render(GameObject* object, const Camera& camera)
+void PlayerLoop::unregisterBehaviour(Behaviour* b)
 {
-    // アタッチされている各コンポーネントのRenderを呼ぶ
-    for (auto& it : object->GetComponents())
-    {
-        auto renderer = dynamic_cast<Renderer*>(it.get());
-        if (renderer != nullptr && renderer->enabled)
-        {
-            renderer->render(camera);
-        }
-    }
-
-    // 子供のオブジェクトについて再帰
-    for (auto& it : object->transform->getChildGameObjects())
-    {
-        render(&*it, camera);
-    }
+    fixedUpdateList_.remove(b);
+    updateList_.remove(b);
+    lateUpdateList_.remove(b);
+    parallelUpdateList_.remove(b);
+    startQueue_.remove(b);
 }
 
 
-void PlayerLoop::registerCanvas(Canvas* c)
+// プールに確保したものはプールを走査して描画するので、印だけ付ける
+void PlayerLoop::registerRenderer(Renderer* r)
 {
-    canvas_.push_back(c);
+    r->rendering_ = true;
+    if (r->pool_ == nullptr) rendererList_.add(r);
 }
 
 
-void PlayerLoop::unregisterCanvas(Canvas* c)
+void PlayerLoop::unregisterRenderer(Renderer* r)
 {
-    auto it = std::find(canvas_.begin(), canvas_.end(), c);
-    if (it != canvas_.end()) canvas_.erase(it);
+    r->rendering_ = false;
+    rendererList_.remove(r);
 }
 
 
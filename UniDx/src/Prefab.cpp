@@ -0,0 +1,225 @@
+﻿#include "pch.h"
+#include <UniDx/Prefab.h>
+
+namespace UniDx
+{
+
+// コンストラクタ
+Prefab::Prefab(unique_ptr<GameObject> source, size_t prewarm) :
+    source_(std::move(source))
+{
+    assert(source_ != nullptr && source_->transform->parent == nullptr);
+    Prewarm(prewarm);
+}
+
+
+// プールしているインスタンスが count 個になるまで作っておく
+void Prefab::Prewarm(size_t count)
+{
+    pool_.reserve(count);
+    while (pool_.size() < count)
+    {
+        pool_.push_back(createInstance());
+    }
+}
+
+
+// インスタンスを parent の子にして有効にする
+GameObject* Prefab::Instantiate(Transform* parent)
+{
+    GameObject* instance = attach(parent);
+    activateRecursive(instance);
+    return instance;
+}
+
+
+// インスタンスをワールド空間の姿勢に置いて有効にする
+// 有効にする前に置くので、OnEnable() では新しい位置を参照できる
+GameObject* Prefab::Instantiate(Transform* parent, Vector3 position, Quaternion rotation)
+{
+    GameObject* instance = attach(parent);
+    instance->transform->position = position;
+    instance->transform->rotation = rotation;
+    activateRecursive(instance);
+    return instance;
+}
+
+
+// インスタンスを無効にして親から外し、プールに戻す
+void Prefab::Release(GameObject* instance)
+{
+    assert(instance != nullptr && instance->prefab_ == this);
+    if (auto commands = CommandBuffer::current())
+    {
+        // 並列更新中は同期点で実行
+        commands->add([this, instance]() { Release(instance); });
+        return;
+    }
+
+    // すでにプールにあるか、破棄が決まっている
+    Transform* t = instance->transform;
+    if (t->parent == nullptr || instance->isCalledDestroy) return;
+
+    deactivateRecursive(instance);
+
+    // 親から所有権ごと外してプールへ
+    auto owner = t->parent->removeChild(t);
+    t->parent = nullptr;
+    t->hierarchy().setParent(t->index_, TransformHierarchy::InvalidIndex);
+    pool_.push_back(std::move(owner));
+}
+
+
+// プールから取り出すか新しく作ったインスタンスを parent の子にする
+GameObject* Prefab::attach(Transform* parent)
+{
+    // 親のないGameObjectは誰も所有しないので、必ず親を指定する
+    assert(parent != nullptr);
+    assert(CommandBuffer::current() == nullptr); // 並列更新中は使えない
+
+    unique_ptr<GameObject> instance;
+    if (!pool_.empty())
+    {
+        instance = std::move(pool_.back());
+        pool_.pop_back();
+
+        // 前に使っていたときの姿勢を戻す
+        Transform* t = instance->transform;
+        Transform* st = source_->transform;
+        t->localPosition = st->localPosition;
+        t->localRotation = st->localRotation;
+        t->localScale = st->localScale;
+    }
+    else
+    {
+        instance = createInstance();
+    }
+
+    GameObject* ptr = instance.get();
+    Transform::SetParent(std::move(instance), parent);
+    return ptr;
+}
+
+
+// テンプレートを複製して、無効のままのインスタンスを作る
+// 全て複製し終えてから、複製元を指しているポインタを置き換える
+unique_ptr<GameObject> Prefab::createInstance()
+{
+    cloneMap_.clear();
+    auto instance = cloneRecursive(source_.get());
+    resolveRecursive(instance.get());
+    instance->prefab_ = this;
+    return instance;
+}
+
+
+unique_ptr<GameObject> Prefab::cloneRecursive(const GameObject* source)
+{
+    auto instance = make_unique<GameObject>(source->name_);
+
+    // 姿勢（静的なTransformは動かせないので isStatic は写さない）
+    Transform* t = instance->transform;
+    Transform* st = source->transform;
+    t->localPosition = st->localPosition;
+    t->localRotation = st->localRotation;
+    t->localScale = st->localScale;
+    t->keepChildOrder = st->keepChildOrder;
+    cloneMap_.add(source, instance.get());
+    cloneMap_.add(st, t);
+
+    // コンポーネント（Transformは GameObject のコンストラクタで追加済み）
+    for (auto& c : source->components)
+    {
+        if (c.get() == st || c->isDestroyed()) continue;
+
+        auto copy = c->clone(cloneMap_);
+        assert(copy != nullptr); // clone() をオーバーライドしていないコンポーネントは複製できない
+        if (copy == nullptr) continue;
+
+        copy->_enabled = false; // Instantiate() で有効にする
+        copy->prefabSource_ = c.get();
+        cloneMap_.add(c.get(), copy.get());
+        instance->Add(std::move(copy));
+    }
+
+    // 子供のオブジェクトについて再帰
+    for (auto& child : st->getChildGameObjects())
+    {
+        Transform::SetParent(cloneRecursive(child.get()), t);
+    }
+    return instance;
+}
+
+
+void Prefab::resolveRecursive(GameObject* instance)
+{
+    for (auto& c : instance->components)
+    {
+        c->resolveClone(cloneMap_);
+    }
+    for (auto& child : instance->transform->getChildGameObjects())
+    {
+        resolveRecursive(child.get());
+    }
+}
+
+
+// 複製したコンポーネントのうち、複製元で有効なものを有効にする
+// 初回は Awake(), OnEnable() の順、再利用したときは OnEnable() だけが呼ばれる
+// 子やコンポーネントの並び順は実行中に変わるので、位置ではなく複製元のポインタで対応をとる
+void Prefab::activateRecursive(GameObject* instance)
+{
+    // OnEnable() でコンポーネントが追加されることがあるので位置で回す
+    for (size_t i = 0; i < instance->components.size(); ++i)
+    {
+        Component* c = instance->components[i].get();
+        if (c->prefabSource_ != nullptr && c->prefabSource_->_enabled && !c->isDestroyed())
+        {
+            c->enabled = true;
+        }
+    }
+
+    for (auto& child : instance->transform->getChildGameObjects())
+    {
+        activateRecursive(child.get());
+    }
+}
+
+
+// 複製したコンポーネントを後ろから無効にする（OnDisable() が呼ばれる）
+// Transformを指すハンドルも無効にし、プールにある間や再利用した後に古い参照から動かされないようにする
+void Prefab::deactivateRecursive(GameObject* instance)
+{
+    Transform* t = instance->transform;
+    t->hierarchy().renewHandle(t->index_);
+
+    for (auto it = instance->components.rbegin(); it != instance->components.rend(); ++it)
+    {
+        Component* c = it->get();
+        if (c->prefabSource_ != nullptr)
+        {
+            c->enabled = false;
+        }
+    }
+    for (auto& child : instance->transform->getChildGameObjects())
+    {
+        deactivateRecursive(child.get());
+    }
+}
+
+
+// Prefab から作ったものはプールに戻し、それ以外は破棄する
+void Release(GameObject* gameObject)
+{
+    assert(gameObject != nullptr);
+    if (Prefab* prefab = gameObject->getPrefab())
+    {
+        prefab->Release(gameObject);
+    }
+    else
+    {
+        Destroy(gameObject);
+    }
+}
+
+}
@@ -62,7 +62,8 @@ void CubeRenderer::OnEnable()
 {
     MeshRenderer::OnEnable();
 
-    // メッシュの初期化
+    // メッシュの初期化（プールから再利用したときは作成済み）
+    if (!mesh.submesh.empty()) return;
     auto submesh = std::make_unique<SubMesh>();
     submesh->positions = std::span<const Vector3>(static_cast<const Vector3*>(cube_positions), std::size(cube_positions));
     submesh->uv = std::span<const Vector2>(static_cast<const Vector2*>(cube_uvs), std::size(cube_uvs));
@@ -134,6 +135,8 @@ void SphereRenderer::OnEnable()
 {
     MeshRenderer::OnEnable();
 
+    // プールから再利用したときは作成済み
+    if (!mesh.submesh.empty()) return;
     createVertex();
 
     auto submesh = std::make_unique<SubMesh>();
@@ -0,0 +1,290 @@
+﻿#include "pch.h"
+#include <UniDx/Profiler.h>
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+
+namespace UniDx
+{
+
+namespace
+{
+
+// スレッドごとのリングバッファ
+// 書き込むのは持ち主のスレッドだけで、読み出す側は head_ から読める範囲を判断する
+struct ThreadBuffer
+{
+    uint32_t id = 0;
+    std::string name;       // registry().mutex で保護
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint64_t> head = 0; // これまでに書き込んだ数
+    uint32_t depth = 0;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<ThreadBuffer*> buffers; // スレッドが終了しても記録を残すため解放しない
+    std::atomic<int64_t> clearTime = INT64_MIN;
+};
+
+// 終了時の破棄順に依存しないよう、解放しない
+Registry& registry()
+{
+    static Registry* r = new Registry();
+    return *r;
+}
+
+thread_local ThreadBuffer* currentBuffer = nullptr;
+thread_local std::string threadName;
+
+// このスレッドのバッファ（最初に記録するときに作成）
+ThreadBuffer& threadBuffer()
+{
+    if (currentBuffer == nullptr)
+    {
+        auto b = new ThreadBuffer();
+        b->events = std::make_unique<ProfileEvent[]>(Profiler::RingCapacity);
+
+        Registry& r = registry();
+        std::lock_guard lock(r.mutex);
+        b->id = uint32_t(r.buffers.size());
+        b->name = threadName.empty() ? "Thread " + std::to_string(b->id) : threadName;
+        r.buffers.push_back(b);
+        currentBuffer = b;
+    }
+    return *currentBuffer;
+}
+
+// 処理時間（ミリ秒）から統計を作る
+ProfileStats makeStats(const char* name, std::vector<double>& times)
+{
+    ProfileStats s;
+    s.name = name;
+    if (times.empty()) return s;
+
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for (double t : times) total += t;
+
+    s.count = times.size();
+    s.mean = total / double(times.size());
+    s.p95 = times[(times.size() * 95 + 99) / 100 - 1];
+    s.max = times.back();
+    return s;
+}
+
+// JSONの文字列として書き出す
+void writeJsonString(std::ostream& out, const char* s)
+{
+    out << '"';
+    for (; *s != '\0'; ++s)
+    {
+        const char c = *s;
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (uint8_t(c) < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+}
+
+
+// このスレッドの名前を設定する
+void Profiler::setThreadName(const char* name)
+{
+    threadName = name;
+    if (currentBuffer != nullptr)
+    {
+        std::lock_guard lock(registry().mutex);
+        currentBuffer->name = name;
+    }
+}
+
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// これまでの記録を捨てる
+// 他のスレッドのバッファには触れず、この時刻より前に終わったものを読み出さないようにする
+void Profiler::clear()
+{
+    registry().clearTime.store(now(), std::memory_order_relaxed);
+}
+
+
+int64_t Profiler::beginZone()
+{
+    ++threadBuffer().depth;
+    return now();
+}
+
+
+// 終了したゾーンをリングバッファに書き込む
+void Profiler::endZone(const char* name, uint32_t hash, int64_t begin)
+{
+    const int64_t end = now();
+    ThreadBuffer& b = threadBuffer();
+    --b.depth;
+
+    const uint64_t h = b.head.load(std::memory_order_relaxed);
+    b.events[h & (RingCapacity - 1)] = ProfileEvent{ name, hash, b.depth, begin, end };
+    b.head.store(h + 1, std::memory_order_release);
+}
+
+
+// 記録されているゾーンを全スレッド分取得する
+void Profiler::collect(std::vector<ProfileEvent>& events, std::vector<uint32_t>* threadIds)
+{
+    static_assert((RingCapacity & (RingCapacity - 1)) == 0);
+
+    Registry& r = registry();
+    const int64_t clearTime = r.clearTime.load(std::memory_order_relaxed);
+
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard lock(r.mutex);
+        buffers = r.buffers;
+    }
+
+    for (ThreadBuffer* b : buffers)
+    {
+        const uint64_t head = b->head.load(std::memory_order_acquire);
+        const uint64_t first = head > RingCapacity ? head - RingCapacity : 0;
+
+        std::vector<ProfileEvent> copied;
+        copied.reserve(size_t(head - first));
+        for (uint64_t i = first; i < head; ++i)
+        {
+            copied.push_back(b->events[i & (RingCapacity - 1)]);
+        }
+
+        // 読んでいる間に上書きされた可能性のあるもの（書き込み中の１つを含む）は捨てる
+        const uint64_t after = b->head.load(std::memory_order_acquire) + 1;
+        const uint64_t valid = after > RingCapacity ? after - RingCapacity : 0;
+        const size_t skip = size_t(std::min(valid > first ? valid - first : 0, head - first));
+
+        for (size_t i = skip; i < copied.size(); ++i)
+        {
+            if (copied[i].end < clearTime) continue;
+            events.push_back(copied[i]);
+            if (threadIds != nullptr) threadIds->push_back(b->id);
+        }
+    }
+}
+
+
+// 記録されている name のゾーンの統計
+ProfileStats Profiler::getStats(const char* name)
+{
+    std::vector<ProfileEvent> events;
+    collect(events);
+
+    const uint32_t hash = ProfileZoneId::Hash(name);
+    std::vector<double> times;
+    for (auto& e : events)
+    {
+        if (e.hash == hash) times.push_back(double(e.end - e.begin) * 1e-6);
+    }
+    return makeStats(name, times);
+}
+
+
+// 記録されている全てのゾーンの統計
+std::vector<ProfileStats> Profiler::getAllStats()
+{
+    std::vector<ProfileEvent> events;
+    collect(events);
+
+    // ハッシュごとに処理時間を集める
+    std::unordered_map<uint32_t, std::pair<const char*, std::vector<double>>> zones;
+    for (auto& e : events)
+    {
+        auto& zone = zones.try_emplace(e.hash, e.name, std::vector<double>()).first->second;
+        zone.second.push_back(double(e.end - e.begin) * 1e-6);
+    }
+
+    std::vector<ProfileStats> result;
+    result.reserve(zones.size());
+    for (auto& [hash, zone] : zones)
+    {
+        result.push_back(makeStats(zone.first, zone.second));
+    }
+
+    std::sort(result.begin(), result.end(),
+        [](const ProfileStats& a, const ProfileStats& b) { return a.mean * double(a.count) > b.mean * double(b.count); });
+    return result;
+}
+
+
+// Chrome trace 形式のJSONを書き出す
+// 時刻は最初に始まったゾーンを 0 としたマイクロ秒
+void Profiler::writeChromeTrace(std::ostream& out)
+{
+    std::vector<ProfileEvent> events;
+    std::vector<uint32_t> threadIds;
+    collect(events, &threadIds);
+
+    int64_t origin = INT64_MAX;
+    for (auto& e : events) origin = std::min(origin, e.begin);
+
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"traceEvents\":[\n";
+    bool firstEvent = true;
+    auto separator = [&]() { out << (firstEvent ? "" : ",\n"); firstEvent = false; };
+
+    // スレッドの名前
+    {
+        Registry& r = registry();
+        std::lock_guard lock(r.mutex);
+        for (ThreadBuffer* b : r.buffers)
+        {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->id << ",\"args\":{\"name\":";
+            writeJsonString(out, b->name.c_str());
+            out << "}}";
+        }
+    }
+
+    // ゾーンは完了イベントとして書き出す（入れ子は時刻から復元される）
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const ProfileEvent& e = events[i];
+        separator();
+        out << "{\"name\":";
+        writeJsonString(out, e.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadIds[i]
+            << ",\"ts\":" << double(e.begin - origin) * 1e-3
+            << ",\"dur\":" << double(e.end - e.begin) * 1e-3 << "}";
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+
+bool Profiler::writeChromeTrace(const u8string& filePath)
+{
+    std::ofstream file(std::filesystem::path(filePath), std::ios::binary);
+    if (!file) return false;
+
+    writeChromeTrace(file);
+    return bool(file);
+}
+
+} // namespace UniDx
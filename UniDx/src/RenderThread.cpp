@@ -0,0 +1,100 @@
+﻿#include "pch.h"
+#include <UniDx/RenderThread.h>
+#include <UniDx/Profiler.h>
+
+#include <algorithm>
+
+namespace UniDx
+{
+
+// コンストラクタ
+// パケットを用意して描画スレッドを起動する
+RenderThread::RenderThread(int frameLatency)
+{
+    frameLatency = std::clamp(frameLatency, 1, 2);
+    for (int i = 0; i < frameLatency; ++i)
+    {
+        packets_.push_back(std::make_unique<FramePacket>());
+        free_.push_back(packets_.back().get());
+    }
+    thread_ = std::thread(&RenderThread::threadMain, this);
+}
+
+
+// デストラクタ
+// 依頼済みのフレームを描画し終えてからスレッドを終了する
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard lock(mutex_);
+        quit_ = true;
+    }
+    submitted_.notify_one();
+    thread_.join();
+}
+
+
+// 空いているパケットを取得する
+FramePacket& RenderThread::acquire()
+{
+    UNIDX_PROFILE_ZONE("RenderThread.acquire");
+    std::unique_lock lock(mutex_);
+    released_.wait(lock, [this]() { return !free_.empty(); });
+
+    FramePacket* packet = free_.back();
+    free_.pop_back();
+    lock.unlock();
+
+    packet->clear();
+    return *packet;
+}
+
+
+// 描画を依頼する
+void RenderThread::submit(FramePacket& packet)
+{
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back(&packet);
+    }
+    submitted_.notify_one();
+}
+
+
+// 依頼したフレームの描画が全て終わるまで待つ
+void RenderThread::flush()
+{
+    std::unique_lock lock(mutex_);
+    released_.wait(lock, [this]() { return queue_.empty() && !rendering_; });
+}
+
+
+// 描画スレッドの処理
+void RenderThread::threadMain()
+{
+    Profiler::setThreadName("Render");
+
+    while (true)
+    {
+        FramePacket* packet;
+        {
+            std::unique_lock lock(mutex_);
+            submitted_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+            if (queue_.empty()) break; // 終了
+            packet = queue_.front();
+            queue_.pop_front();
+            rendering_ = true;
+        }
+
+        packet->execute();
+
+        {
+            std::lock_guard lock(mutex_);
+            rendering_ = false;
+            free_.push_back(packet);
+        }
+        released_.notify_all();
+    }
+}
+
+}
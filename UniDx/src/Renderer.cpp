@@ -7,10 +7,54 @@
 #include <UniDx/Material.h>
 #include <UniDx/SceneManager.h>
 #include <UniDx/LightManager.h>
+#include <UniDx/PlayerLoop.h>
+#include <UniDx/FramePacket.h>
 
 namespace UniDx{
 
 
+// -----------------------------------------------------------------------------
+// デストラクタ
+// 有効なまま破棄されたときも描画リストに残さない
+// -----------------------------------------------------------------------------
+Renderer::~Renderer()
+{
+    unregisterLoop();
+}
+
+
+// -----------------------------------------------------------------------------
+// 複製用のコピーコンストラクタ
+// -----------------------------------------------------------------------------
+Renderer::Renderer(const Renderer& source) :
+    Component(source),
+    materials(source.materials),
+    lightCount(source.lightCount)
+{
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画リストへの登録
+// -----------------------------------------------------------------------------
+void Renderer::registerLoop()
+{
+    if (auto loop = PlayerLoop::getInstance())
+    {
+        loop->registerRenderer(this);
+    }
+}
+
+
+void Renderer::unregisterLoop()
+{
+    if (auto loop = PlayerLoop::getInstance())
+    {
+        loop->unregisterRenderer(this);
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // 有効化
 // -----------------------------------------------------------------------------
@@ -22,8 +66,20 @@ void Renderer::OnEnable()
         material->OnEnable();
     }
 
-    // 行列用の定数バッファ生成
-    createConstantBufferPerObject();
+    // 行列用の定数バッファ生成（プールから再利用したときは作ってあるものを使う）
+    if (constantBufferPerObject == nullptr)
+    {
+        createConstantBufferPerObject();
+    }
+    transformVersion_ = 0;
+
+    // ライト用の定数バッファ生成
+    if (lightCount > 0 && constantBufferLightPerObject == nullptr)
+    {
+        constantBufferLightPerObject = LightManager::getInstance()->createLightCBufferObject();
+    }
+    lightTransformVersion_ = 0;
+    lightsVersion_ = 0;
 }
 
 
@@ -37,34 +93,46 @@ void Renderer::createConstantBufferPerObject()
     desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     desc.CPUAccessFlags = 0;
     desc.Usage = D3D11_USAGE_DEFAULT;
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBufferPerObject.GetAddressOf());
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBuffer(&desc, nullptr, constantBufferPerObject.GetAddressOf());
+    }
 }
 
 
 // -----------------------------------------------------------------------------
-// 現在の姿勢をシェーダーの定数バッファに転送
+// 現在の姿勢を、シェーダーの定数バッファへの転送としてパケットに写す
 // -----------------------------------------------------------------------------
-void Renderer::bindPerObject()
+void Renderer::extractPerObject(FramePacket& packet)
 {
-    // ワールド行列を transform から合わせて作成
-    ConstantBufferPerObject cb{};
-    cb.world = transform->localToWorldMatrix();
-    D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferPerObject.Get(), 0, nullptr, &cb, 0, 0);
-
-    // 定数バッファ更新
-    ID3D11Buffer* cbs[1] = { constantBufferPerObject.Get() };
-    D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(CB_PerObject, 1, cbs);
+    // 前回の転送から動いていなければ転送しない
+    if (transform->hasChangedSince(transformVersion_))
+    {
+        // ワールド行列を transform から合わせて作成
+        ConstantBufferPerObject cb{};
+        cb.world = transform->localToWorldMatrix();
+        packet.addUpload(constantBufferPerObject, cb);
+        transformVersion_ = transform->getVersion();
+    }
 }
 
 
 // -----------------------------------------------------------------------------
-// オブジェクトに合わせたライト情報をシェーダーの定数バッファに転送
+// オブジェクトに合わせたライト情報を、シェーダーの定数バッファへの転送としてパケットに写す
 // -----------------------------------------------------------------------------
-void Renderer::bindLightPerObject()
+void Renderer::extractLightPerObject(FramePacket& packet)
 {
     if(lightCount > 0)
     {
-        LightManager::getInstance()->updateLightCBufferObject(transform->position, lightCount);
+        LightManager* lightManager = LightManager::getInstance();
+
+        // 自分もライトも動いていなければ前回選んだライトのまま
+        if (transform->hasChangedSince(lightTransformVersion_) || lightsVersion_ != lightManager->getLightsVersion())
+        {
+            lightManager->extractLightCBufferObject(packet, transform->position, lightCount, constantBufferLightPerObject);
+            lightTransformVersion_ = transform->getVersion();
+            lightsVersion_ = lightManager->getLightsVersion();
+        }
     }
 }
 
@@ -79,30 +147,21 @@ MeshRenderer::MeshRenderer()
 
 
 // -----------------------------------------------------------------------------
-// メッシュを使って描画
+// メッシュとマテリアルの描画をパケットに写す
 // -----------------------------------------------------------------------------
-void MeshRenderer::render(const Camera& camera)
+void MeshRenderer::extract(FramePacket& packet)
 {
-    // レンダーモードが一致するマテリアルがあるか確認
-    auto it = std::ranges::find_if(materials, 
-        [](auto& m){
-            return m != nullptr && m->renderingMode == D3DManager::getInstance()->getCurrentRenderingMode();
-        });
-    if(it == materials.end())
-    {
-        return;
-    }
+    packet.addDraw(this, transform->localToWorldMatrix(), constantBufferPerObject,
+        lightCount > 0 ? constantBufferLightPerObject : nullptr);
 
-    // 現在のTransformの情報をシェーダーのConstantBufferに転送
-    bindPerObject();
+    // 現在のTransformの情報
+    extractPerObject(packet);
 
-    // オブジェクトに合わせたライト情報をシェーダーのConstantBufferに転送
-    bindLightPerObject();
+    // オブジェクトに合わせたライト情報
+    extractLightPerObject(packet);
 
-    //-----------------------------
-    // 描画実行
-    //-----------------------------
-    mesh.render(materials);
+    // 描画するサブメッシュとマテリアル
+    packet.addMesh(mesh, materials);
 }
 
 }
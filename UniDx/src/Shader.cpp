@@ -6,6 +6,7 @@
 
 #include <UniDx/D3DManager.h>
 #include <UniDx/ConstantBuffer.h>
+#include <UniDx/Profiler.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
@@ -54,6 +55,8 @@ const std::array< D3D11_INPUT_ELEMENT_DESC, 3> VertexPNC::layout =
 
 bool Shader::compile(const u8string& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
 {
+	UNIDX_PROFILE_ZONE("Shader.compile");
+
 	ID3DBlob* error = nullptr;
 
 	// 頂点シェーダーを読み込み＆コンパイル
@@ -4,6 +4,8 @@
 #include <UniDx/D3DManager.h>
 #include <UniDx/Texture.h>
 #include <UniDx/Material.h>
+#include <UniDx/FramePacket.h>
+#include <UniDx/Prefab.h>
 
 namespace UniDx{
 
@@ -28,6 +30,13 @@ SkinnedMeshRenderer::SkinnedMeshRenderer()
 }
 
 
+// 複製元のスキンを複製先のものに置き換える
+void SkinnedMeshRenderer::resolveClone(const CloneMap& map)
+{
+    skin = map(skin);
+}
+
+
 // 現在の姿勢をシェーダーの定数バッファに転送
 void SkinnedMeshRenderer::createConstantBufferPerObject()
 {
@@ -36,41 +45,57 @@ void SkinnedMeshRenderer::createConstantBufferPerObject()
     desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     desc.CPUAccessFlags = 0;
     desc.Usage = D3D11_USAGE_DEFAULT;
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBufferPerObject.GetAddressOf());
+    if (auto device = D3DManager::findDevice())
+    {
+        device->CreateBuffer(&desc, nullptr, constantBufferPerObject.GetAddressOf());
+    }
 
     constantBuffer = make_unique<ConstantBufferSkinPerObject>();
+    jointVersions_.clear();
 }
 
 
-// 現在の姿勢をシェーダーの定数バッファに転送
-void SkinnedMeshRenderer::bindPerObject()
+// 現在の姿勢とボーン行列を、シェーダーの定数バッファへの転送としてパケットに写す
+void SkinnedMeshRenderer::extractPerObject(FramePacket& packet)
 {
-    // ワールド行列を transform から合わせて作成
-    constantBuffer->world = transform->localToWorldMatrix();
-
-    // ボーン行列
-    if(skin && !skin->joints.empty())
+    // 自分とジョイントがどれも動いていなければ、前回のボーン行列のまま
+    bool changed = transform->hasChangedSince(transformVersion_);
+    const uint32_t n = skin ? (uint32_t)std::min<size_t>(skin->joints.size(), SkinMeshBoneMax) : 0;
+    if (jointVersions_.size() != n)
     {
-        Matrix4x4 invWorld = constantBuffer->world.inverse();
+        jointVersions_.assign(n, 0);
+        changed = true;
+    }
+    for (uint32_t i = 0; i < n && !changed; ++i)
+    {
+        changed = skin->joints[i]->hasChangedSince(jointVersions_[i]);
+    }
 
-        const uint32_t n = (uint32_t)std::min<size_t>(skin->joints.size(), SkinMeshBoneMax);
+    if (changed)
+    {
+        // ワールド行列を transform から合わせて作成
+        constantBuffer->world = transform->localToWorldMatrix();
+        transformVersion_ = transform->getVersion();
 
-        for(uint32_t i = 0; i < n; ++i)
+        // ボーン行列
+        if (n > 0)
         {
-            // 頂点データ → ワールド座標 → モデル座標 となる変換
-            Matrix4x4 jointWorld = skin->joints[i]->localToWorldMatrix();
-            Matrix4x4 m = skin->inverseBind[i] * jointWorld * invWorld;
-
-            // CB用 3x4 に圧縮
-            constantBuffer->bones[i] = BoneMat3x4::FromMatrix4x4(m);
+            Matrix4x4 invWorld = transform->worldToLocalMatrix();
+
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                // 頂点データ → ワールド座標 → モデル座標 となる変換
+                const Matrix4x4& jointWorld = skin->joints[i]->localToWorldMatrix();
+                Matrix4x4 m = skin->inverseBind[i] * jointWorld * invWorld;
+                jointVersions_[i] = skin->joints[i]->getVersion();
+
+                // CB用 3x4 に圧縮
+                constantBuffer->bones[i] = BoneMat3x4::FromMatrix4x4(m);
+            }
         }
-    }
 
-    D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBufferPerObject.Get(), 0, nullptr, constantBuffer.get(), 0, 0);
-
-    // 定数バッファ更新
-    ID3D11Buffer* cbs[1] = { constantBufferPerObject.Get() };
-    D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(CB_PerObject, 1, cbs);
+        packet.addUpload(constantBufferPerObject, *constantBuffer);
+    }
 }
 
 
@@ -3,6 +3,7 @@
 #include <UniDx/TextMesh.h>
 #include <UniDx/D3DManager.h>
 #include <UniDx/Font.h>
+#include <UniDx/FramePacket.h>
 
 using namespace DirectX;
 
@@ -18,26 +19,28 @@ TextMesh::TextMesh() :
 void TextMesh::Awake()
 {
 	UIBehaviour::Awake();
-	spriteBatch = std::make_unique<SpriteBatch>(D3DManager::getInstance()->GetContext().Get());
+	spriteBatch = std::make_shared<SpriteBatch>(D3DManager::getInstance()->GetContext().Get());
 }
 
 
-void TextMesh::render(const Matrix4x4& proj) const
+void TextMesh::extract(FramePacket& packet, const Matrix4x4& proj) const
 {
-	UIBehaviour::render(proj);
+	UIBehaviour::extract(packet, proj);
     if(spriteBatch == nullptr || font == nullptr || font->getSpriteFont() == nullptr) return;
 
-    // SpriteFontを使った描画
-    spriteBatch->Begin();
-
     Vector3 pos = transform->position;
     Vector3 scale = transform->localScale; // 現状はローカルスケールのみ
     Vector2 drawPos(pos.x, pos.y);
-    font->getSpriteFont()->DrawString(
-        spriteBatch.get(), u16text.c_str(), drawPos, color.XMLoad(), 0.0f, Vector2::zero,
-        Vector2(scale.x, scale.y) );
 
-    spriteBatch->End();
+    // SpriteFontを使った描画（文字列と色はこのフレームのものをコピーしておく）
+    packet.overlays.push_back(
+        [spriteBatch = spriteBatch, font = font, text = u16text, drawPos, color = color, scale = Vector2(scale.x, scale.y)]()
+        {
+            spriteBatch->Begin();
+            font->getSpriteFont()->DrawString(
+                spriteBatch.get(), text.c_str(), drawPos, color.XMLoad(), 0.0f, Vector2::zero, scale);
+            spriteBatch->End();
+        });
 }
 
 }
@@ -4,6 +4,7 @@
 #include <filesystem>
 
 #include <UniDx/D3DManager.h>
+#include <UniDx/Profiler.h>
 
 
 namespace UniDx
@@ -35,6 +36,8 @@ void Texture::ensureSampler_()
 
 bool Texture::Load(const u8string& filePath)
 {
+	UNIDX_PROFILE_ZONE("Texture.Load");
+
 	// WIC画像を読み込む
 	auto image = std::make_unique<DirectX::ScratchImage>();
 	if (FAILED(DirectX::LoadFromWICFile(ToUtf16(filePath).c_str(), DirectX::WIC_FLAGS_NONE, &m_info, *image)))
@@ -7,168 +7,144 @@ namespace UniDx
 
 // コンストラクタ
 Transform::Transform()
-    : localPosition(
-        [this]() { return _localPosition; },
-        [this](Vector3 v) { _localPosition = v; m_dirty = true; }
-    ),
-    localRotation(
-        [this]() { return _localRotation; },
-        [this](Quaternion q) { _localRotation = q; m_dirty = true; }
-    ),
-    localScale(
-        [this]() { return _localScale; },
-        [this](Vector3 v) { _localScale = v; m_dirty = true; }
-    ),
-    position(
-        // getter: グローバル座標
-        [this]() {
-            updateMatrices();
-            return m_worldMatrix.translation();
-        },
-        // setter: グローバル座標からlocalPositionを逆算
-        [this](Vector3 worldPos) {
-            if (parent) {
-                parent->updateMatrices();
-                Matrix4x4 invParent = parent->m_worldMatrix.inverse();
-                _localPosition = worldPos * invParent;
-            }
-            else {
-                _localPosition = worldPos;
-            }
-            m_dirty = true;
-        }
-    ),
-    rotation(
-        [this]() {
-            updateMatrices();
-            // ワールド行列からクォータニオンを取得
-            Vector3 s, t;
-            Quaternion q;
-            m_worldMatrix.Decompose(s, q, t);
-            return q;
-        },
-        [this](Quaternion worldRot) {
-            if (parent) {
-                parent->updateMatrices();
-                // 親のワールド回転の逆を掛けてローカル回転を算出
-                Quaternion parentWorldRot, parentWorldRotInv;
-                Vector3 s, t;
-                parent->m_worldMatrix.Decompose(s, parentWorldRot, t);
-                parentWorldRotInv = Inverse(parentWorldRot);
-                _localRotation = worldRot * parentWorldRotInv;
-            }
-            else {
-                _localRotation = worldRot;
-            }
-            m_dirty = true;
-        }
-    ),
-    forward(
-        // getter: ワールド空間の前方向
-        [this]() {
-            return TransformDirection(Vector3::forward);
-        },
-        // setter: worldForward に向くようワールド回転を設定
-        [this](Vector3 worldForward) {
-            if (worldForward.magnitude() < 1e-6f) return;
-            Vector3 f = worldForward.normalized();
-
-            // up が前方向とほぼ平行なら代替 up を使う
-            Vector3 up = Vector3::up;
-            if (std::abs(Dot(f, up)) > 0.999f) up = Vector3::right;
-
-            // CreateWorld の引数は (position, forward, up)
-            Matrix4x4 m = DirectX::SimpleMath::Matrix::CreateWorld(Vector3::zero, f, up);
-            Vector3 s, t;
-            Quaternion q;
-            m.Decompose(s, q, t);
-            rotation = q; // rotation プロパティの setter を使ってローカル回転を設定
-        }
-    ),
-    up(
-        // getter: ワールド空間の上方向
-        [this]() {
-            return TransformDirection(Vector3::up);
-        },
-        // setter: worldUp に向くようワールド回転を設定（可能な限り現在の forward を保持）
-        [this](Vector3 worldUp) {
-            if (worldUp.magnitude() < 1e-6f) return;
-            Vector3 upVec = worldUp.normalized();
-
-            // 現在の forward を取得（ワールド）
-            Vector3 currF = TransformDirection(Vector3::forward);
-
-            // 右方向を計算（forward x up）
-            Vector3 right = Cross(currF, upVec);
-            if (right.magnitude() < 1e-6f) {
-                // forward と up がほぼ平行 -> 別の基準を使う
-                currF = Vector3::forward;
-                right = Cross(currF, upVec);
-            }
-
-            // 再計算した forward を正規化
-            Vector3 f = Cross(upVec, right.normalized()).normalized();
-
-            Matrix4x4 m = DirectX::SimpleMath::Matrix::CreateWorld(Vector3::zero, f, upVec);
-            Vector3 s, t;
-            Quaternion q;
-            m.Decompose(s, q, t);
-            rotation = q;
-        }
-    ),
-    right(
-        // getter: ワールド空間の右方向
-        [this]() {
-            return TransformDirection(Vector3::right);
-        },
-        // setter: worldRight に向くようワールド回転を設定（可能な限り現在の up を保持）
-        [this](Vector3 worldRight) {
-            if (worldRight.magnitude() < 1e-6f) return;
-            Vector3 rVec = worldRight.normalized();
-
-            // 現在の up を取得（ワールド）
-            Vector3 currUp = TransformDirection(Vector3::up);
-
-            // forward を計算 (up x right)
-            Vector3 f = Cross(currUp, rVec);
-            if (f.magnitude() < 1e-6f) {
-                // up と right がほぼ平行 -> 別の基準を使う
-                currUp = Vector3::up;
-                f = Cross(currUp, rVec).normalized();
-            }
-
-            // 再計算した up を正規化
-            Vector3 upVec = Cross(rVec, f).normalized();
-
-            Matrix4x4 m = DirectX::SimpleMath::Matrix::CreateWorld(Vector3::zero, f, upVec);
-            Vector3 s, t;
-            Quaternion q;
-            m.Decompose(s, q, t);
-            rotation = q;
-        }
-    )
 {
+    index_ = hierarchy().allocate(this);
 }
 
+
 Transform::~Transform()
 {
+    TransformHierarchy* h = TransformHierarchy::getInstance();
     for (auto& child : children)
     {
-        if (child) child->transform->parent = nullptr;
+        if (child)
+        {
+            child->transform->parent = nullptr;
+            if (h) h->setParent(child->transform->index_, TransformHierarchy::InvalidIndex);
+        }
     }
+    if (h) h->release(index_);
+}
+
+
+// グローバル座標からlocalPositionを逆算
+void Transform::setPosition(const Vector3& worldPos)
+{
+    if (parent) {
+        hierarchy().localPositions_[index_] = worldPos * parent->worldToLocalMatrix();
+    }
+    else {
+        hierarchy().localPositions_[index_] = worldPos;
+    }
+    markDirty();
+}
+
+
+// ワールド回転からlocalRotationを逆算
+void Transform::setRotation(const Quaternion& worldRot)
+{
+    if (parent) {
+        // 親のワールド回転の逆を掛けてローカル回転を算出
+        hierarchy().localRotations_[index_] = worldRot * Inverse(parent->worldRotation());
+    }
+    else {
+        hierarchy().localRotations_[index_] = worldRot;
+    }
+    markDirty();
+}
+
+
+// worldForward に向くようワールド回転を設定
+void Transform::setForward(const Vector3& worldForward)
+{
+    if (worldForward.magnitude() < 1e-6f) return;
+    Vector3 f = worldForward.normalized();
+
+    // up が前方向とほぼ平行なら代替 up を使う
+    Vector3 upVec = Vector3::up;
+    if (std::abs(Dot(f, upVec)) > 0.999f) upVec = Vector3::right;
+
+    // CreateWorld の引数は (position, forward, up)
+    Matrix4x4 m = DirectX::SimpleMath::Matrix::CreateWorld(Vector3::zero, f, upVec);
+    Vector3 s, t;
+    Quaternion q;
+    m.Decompose(s, q, t);
+    setRotation(q);
+}
+
+
+// worldUp に向くようワールド回転を設定（可能な限り現在の forward を保持）
+void Transform::setUp(const Vector3& worldUp)
+{
+    if (worldUp.magnitude() < 1e-6f) return;
+    Vector3 upVec = worldUp.normalized();
+
+    // 現在の forward を取得（ワールド）
+    Vector3 currF = getForward();
+
+    // 右方向を計算（forward x up）
+    Vector3 rightVec = Cross(currF, upVec);
+    if (rightVec.magnitude() < 1e-6f) {
+        // forward と up がほぼ平行 -> 別の基準を使う
+        currF = Vector3::forward;
+        rightVec = Cross(currF, upVec);
+    }
+
+    // 再計算した forward を正規化
+    Vector3 f = Cross(upVec, rightVec.normalized()).normalized();
+
+    Matrix4x4 m = DirectX::SimpleMath::Matrix::CreateWorld(Vector3::zero, f, upVec);
+    Vector3 s, t;
+    Quaternion q;
+    m.Decompose(s, q, t);
+    setRotation(q);
+}
+
+
+// worldRight に向くようワールド回転を設定（可能な限り現在の up を保持）
+void Transform::setRight(const Vector3& worldRight)
+{
+    if (worldRight.magnitude() < 1e-6f) return;
+    Vector3 rVec = worldRight.normalized();
+
+    // 現在の up を取得（ワールド）
+    Vector3 currUp = getUp();
+
+    // forward を計算 (up x right)
+    Vector3 f = Cross(currUp, rVec);
+    if (f.magnitude() < 1e-6f) {
+        // up と right がほぼ平行 -> 別の基準を使う
+        currUp = Vector3::up;
+        f = Cross(currUp, rVec).normalized();
+    }
+
+    // 再計算した up を正規化
+    Vector3 upVec = Cross(rVec, f).normalized();
+
+    Matrix4x4 m = DirectX::SimpleMath::Matrix::CreateWorld(Vector3::zero, f, upVec);
+    Vector3 s, t;
+    Quaternion q;
+    m.Decompose(s, q, t);
+    setRotation(q);
 }
 
 Vector3 Transform::TransformDirection(Vector3 localDirection) const
 {
     // 平行移動成分を除外した回転・スケールのみ適用
-    Matrix4x4 m = localToWorldMatrix();
-    return m.MultiplyVector(localDirection);
+    return localToWorldMatrix().MultiplyVector(localDirection);
 }
 
 
 // 親の変更
 GameObject* Transform::SetParent(Transform * newParent)
 {
+    if (auto commands = CommandBuffer::current())
+    {
+        // 並列更新中は同期点で実行
+        commands->add([this, newParent]() { SetParent(newParent); });
+        return gameObject;
+    }
+
     // 親のTransformから自分を外す
     if (parent == nullptr)
     {
@@ -176,30 +152,21 @@ GameObject* Transform::SetParent(Transform * newParent)
         abort();
         return nullptr;
     }
-    auto& siblings = parent->children;
 
     // 以前の親からGameObjectのスマートポインタを所有権ごと移動
-    auto it = std::find_if(
-        siblings.begin(), siblings.end(),
-        [this](const unique_ptr<GameObject>& ptr) { return ptr->transform == this; });
-    assert(it != siblings.end());
-
-    GameObject* gameObject_ptr = it->get();
+    auto gameObject_owner = parent->removeChild(this);
+    GameObject* gameObject_ptr = gameObject_owner.get();
     assert(gameObject_ptr != nullptr);
 
-    // 元の親から削除
-    auto gameObject_owner = move(*it);
-    siblings.erase(it);
-
     // 新しい親を設定
     parent = newParent;
 
     if (parent)
     {
         // 新しい親に自分を持つGameObjectを追加
-        parent->children.push_back(std::move(gameObject_owner));
+        parent->addChild(std::move(gameObject_owner));
     }
-    m_dirty = true;
+    hierarchy().setParent(index_, parent ? parent->index_ : TransformHierarchy::InvalidIndex);
 
     return gameObject_ptr;
 }
@@ -207,6 +174,13 @@ GameObject* Transform::SetParent(Transform * newParent)
 
 void Transform::SetParent(unique_ptr<GameObject> gameObjectPtr, Transform* newParent)
 {
+    if (auto commands = CommandBuffer::current())
+    {
+        // 並列更新中は同期点で実行（コマンドは必ず実行されるので所有権は一旦手放す）
+        commands->add([ptr = gameObjectPtr.release(), newParent]() { SetParent(unique_ptr<GameObject>(ptr), newParent); });
+        return;
+    }
+
     // 親のTransformから自分を外す
     if (gameObjectPtr->transform->parent != nullptr)
     {
@@ -216,13 +190,53 @@ void Transform::SetParent(unique_ptr<GameObject> gameObjectPtr, Transform* newPa
     }
 
     // 新しい親を設定
-    gameObjectPtr->transform->parent = newParent;
-    gameObjectPtr->transform->m_dirty = true;
+    Transform* t = gameObjectPtr->transform;
+    t->parent = newParent;
+    t->hierarchy().setParent(t->index_, newParent ? newParent->index_ : TransformHierarchy::InvalidIndex);
     if (newParent)
     {
         // 新しい親に自分を持つGameObjectを追加
-        newParent->children.push_back(std::move(gameObjectPtr));
+        newParent->addChild(std::move(gameObjectPtr));
+    }
+}
+
+
+// 子を末尾に追加
+void Transform::addChild(unique_ptr<GameObject> child)
+{
+    child->transform->siblingIndex_ = (uint32_t)children.size();
+    children.push_back(std::move(child));
+}
+
+
+// 子を外して所有権を返す
+// 位置は siblingIndex_ で分かるので探索しない
+unique_ptr<GameObject> Transform::removeChild(Transform* child)
+{
+    const uint32_t i = child->siblingIndex_;
+    assert(i < children.size() && children[i]->transform == child);
+
+    auto owner = std::move(children[i]);
+    if (keepChildOrder)
+    {
+        // 順序を保つ場合は詰めて、後ろの子の位置を振り直す
+        children.erase(children.begin() + i);
+        for (uint32_t j = i; j < (uint32_t)children.size(); ++j)
+        {
+            children[j]->transform->siblingIndex_ = j;
+        }
+    }
+    else
+    {
+        // 末尾の子を空いた位置に移す
+        if (i + 1 != children.size())
+        {
+            children[i] = std::move(children.back());
+            children[i]->transform->siblingIndex_ = i;
+        }
+        children.pop_back();
     }
+    return owner;
 }
 
 
@@ -237,40 +251,28 @@ Transform* Transform::GetChild(size_t index) const
 
 const Matrix4x4& Transform::localMatrix() const
 {
-    if (m_dirty) {
-        m_localMatrix = DirectX::SimpleMath::Matrix::CreateScale(_localScale.x, _localScale.y, _localScale.z)
-            * DirectX::SimpleMath::Matrix::CreateFromQuaternion(DirectX::XMFLOAT4(_localRotation))
-            * DirectX::SimpleMath::Matrix::CreateTranslation(_localPosition.x, _localPosition.y, _localPosition.z);
-    }
-    return m_localMatrix;
+    updateMatrices();
+    return hierarchy().localMatrices_[index_];
 }
 
 
 // 行列を更新
+// フレーム中に姿勢を変更して読み出したときの遅延更新。
+// フレーム単位では TransformHierarchy::update() がまとめて更新する
 void Transform::updateMatrices() const
 {
+    // 計算済みの静的なTransformは親をたどる必要もない
+    if (hierarchy().isBaked(index_)) return;
+
     if (parent) {
         parent->updateMatrices();
     }
 
-    if (m_dirty)
+    // 子への伝搬は世代番号の比較で行うので、子に印を付ける必要はない
+    auto& h = hierarchy();
+    if (h.needsUpdate(index_))
     {
-        m_localMatrix = DirectX::SimpleMath::Matrix::CreateScale(_localScale)
-            * DirectX::SimpleMath::Matrix::CreateFromQuaternion(DirectX::XMFLOAT4(_localRotation))
-            * DirectX::SimpleMath::Matrix::CreateTranslation(_localPosition);
-        if (parent) {
-            m_worldMatrix = m_localMatrix * parent->m_worldMatrix;
-        }
-        else {
-            m_worldMatrix = m_localMatrix;
-        }
-        m_dirty = false;
-
-        // 親の行列が変わったので、子も変わるように
-        for (auto& c : children)
-        {
-            c->transform->m_dirty = true;
-        }
+        h.computeMatrices(index_);
     }
 }
 
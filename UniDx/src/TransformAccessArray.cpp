@@ -0,0 +1,39 @@
+﻿#include "pch.h"
+#include <UniDx/TransformAccessArray.h>
+
+#include <UniDx/Transform.h>
+
+namespace UniDx
+{
+
+// Transformを追加
+void TransformAccessArray::Add(Transform* transform)
+{
+    handles_.push_back(transform->hierarchy().handleOf(transform->index_));
+}
+
+
+// Transformを探して削除
+bool TransformAccessArray::Remove(Transform* transform)
+{
+    const TransformHierarchy& h = transform->hierarchy();
+    const uint32_t index = transform->index_;
+    for (size_t i = 0; i < handles_.size(); ++i)
+    {
+        if (h.indexOf(handles_[i]) == index)
+        {
+            RemoveAtSwapBack(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// 指定したインデックスのTransform
+Transform* TransformAccessArray::operator[](size_t index) const
+{
+    return TransformHierarchy::getInstance()->find(handles_[index]);
+}
+
+}
@@ -0,0 +1,433 @@
+﻿#include "pch.h"
+#include <UniDx/TransformHierarchy.h>
+#include <UniDx/JobSystem.h>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 階層の並び替えと、ダーティなワールド行列の一括更新
+// -----------------------------------------------------------------------------
+void TransformHierarchy::update()
+{
+    // 末尾に移したものと穴が増えたときだけ全体を並べ替える
+    const uint32_t unordered = (uint32_t)owners_.size() - orderedCount_ + holeCount_;
+    if (orderDirty_ || unordered > std::max(reorderThreshold, orderedCount_ / 4))
+    {
+        rebuildOrder();
+    }
+
+    // 大きな部分木の根を先に更新（親は必ず前に並んでいるので順に処理すればよい）
+    for (uint32_t i : serialIndices_)
+    {
+        updateRange(i, i + 1);
+    }
+
+    // 静的な部分木は並べ替え後に一度だけ計算する
+    for (const Range& r : staticRanges_)
+    {
+        updateRange(r.begin, r.end);
+    }
+    staticRanges_.clear();
+
+    // 残りは互いに独立した部分木なので並列に更新
+    JobSystem::parallelFor(parallelRanges_.size(), 1,
+        [this](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) updateRange(parallelRanges_[i].begin, parallelRanges_[i].end);
+        });
+
+    // 並べ替え後に末尾に追加・移動したもの。親は前にあるので逐次に順に処理すればよい
+    updateRange(orderedCount_, (uint32_t)owners_.size());
+}
+
+
+// 区間内のTransformを前から順に更新
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        // 親は前にあるので、親の世代番号はこの時点で確定している
+        // 穴は dirty_ が 0 で親もないので飛ばされる
+        if (needsUpdate(i))
+        {
+            computeMatrices(i);
+        }
+    }
+}
+
+
+// 1つのTransformのローカル行列とワールド行列、ワールド回転とスケールを計算
+// 親の値は計算済みであること
+void TransformHierarchy::computeMatrices(uint32_t index)
+{
+    using namespace DirectX;
+
+    const XMVECTOR scale = XMLoadFloat3(&localScales_[index]);
+    const XMVECTOR rotation = localRotations_[index].XMLoad();
+
+    // Scale * Rotation * Translation
+    const XMMATRIX local = XMMatrixAffineTransformation(
+        scale, XMVectorZero(), rotation, XMLoadFloat3(&localPositions_[index]));
+    localMatrices_[index].XMStore(local);
+
+    const uint32_t p = parents_[index];
+    if (p != InvalidIndex)
+    {
+        worldMatrices_[index].XMStore(XMMatrixMultiply(local, worldMatrices_[p].XMLoad()));
+        worldRotations_[index].XMStore(XMQuaternionMultiply(rotation, worldRotations_[p].XMLoad()));
+        XMStoreFloat3(&lossyScales_[index], XMVectorMultiply(scale, XMLoadFloat3(&lossyScales_[p])));
+        parentVersions_[index] = versions_[p];
+    }
+    else
+    {
+        worldMatrices_[index].XMStore(local);
+        worldRotations_[index] = localRotations_[index];
+        lossyScales_[index] = localScales_[index];
+    }
+    inverseValid_[index] = 0;
+    dirty_[index] = 0;
+
+    // 世代を進める（0 は未計算を表すので飛ばす）
+    if (++versions_[index] == 0) versions_[index] = 1;
+}
+
+
+// 逆ワールド行列を取得
+const Matrix4x4& TransformHierarchy::inverseWorldMatrix(uint32_t index)
+{
+    if (!inverseValid_[index])
+    {
+        inverseWorldMatrices_[index] = worldMatrices_[index].inverse();
+        inverseValid_[index] = 1;
+    }
+    return inverseWorldMatrices_[index];
+}
+
+
+// -----------------------------------------------------------------------------
+// Transformの登録と削除
+// -----------------------------------------------------------------------------
+// 新しいTransformは根として末尾に追加する（並べ替え済みの区間は変えない）
+uint32_t TransformHierarchy::allocate(Transform* owner)
+{
+    const uint32_t index = appendSlot();
+
+    uint32_t id;
+    if (!freeIds_.empty())
+    {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    }
+    else
+    {
+        id = (uint32_t)idToIndex_.size();
+        idToIndex_.push_back(InvalidIndex);
+        idGenerations_.push_back(0);
+    }
+    ids_[index] = id;
+    idToIndex_[id] = index;
+
+    owners_[index] = owner;
+    parents_[index] = InvalidIndex;
+    localPositions_[index] = Vector3::zero;
+    localRotations_[index] = Quaternion::identity;
+    localScales_[index] = Vector3::one;
+    localMatrices_[index] = Matrix4x4::identity;
+    worldMatrices_[index] = Matrix4x4::identity;
+    worldRotations_[index] = Quaternion::identity;
+    lossyScales_[index] = Vector3::one;
+    inverseValid_[index] = 0;
+    dirty_[index] = 1;
+    static_[index] = 0;
+    versions_[index] = 0;
+    parentVersions_[index] = 0;
+    subtreeSizes_[index] = 1;
+
+    return index;
+}
+
+
+// 位置は穴として残し、次の並べ替えで詰める
+void TransformHierarchy::release(uint32_t index)
+{
+    // ハンドルを無効にしてIDを再利用できるようにする
+    const uint32_t id = ids_[index];
+    idToIndex_[id] = InvalidIndex;
+    ++idGenerations_[id];
+    freeIds_.push_back(id);
+    ids_[index] = InvalidIndex;
+
+    owners_[index] = nullptr;
+    parents_[index] = InvalidIndex;
+    dirty_[index] = 0;
+    static_[index] = 0;
+    ++holeCount_;
+}
+
+
+void TransformHierarchy::setParent(uint32_t index, uint32_t parentIndex)
+{
+    if (parents_[index] == parentIndex)
+    {
+        dirty_[index] = 1;
+        return;
+    }
+
+    // 根にするだけなら、区間の中にあっても他の区間の値は読まないのでそのままでよい。
+    // 親をつなぐときは、並べ替え済みの区間の中だと別の区間を更新するスレッドと競合し、
+    // 親が後ろにあると親より先に更新されてしまうので、部分木ごと末尾に移す
+    if (parentIndex != InvalidIndex && (index < orderedCount_ || parentIndex > index))
+    {
+        moveSubtreeToEnd(index, parentIndex);
+        return;
+    }
+
+    parents_[index] = parentIndex;
+    dirty_[index] = 1;
+}
+
+
+// 静的にするのは区間の分け方を変えなくても正しく動くので、次の並べ替えまでそのままにする
+// 静的でなくするときは、一度だけ計算する区間に入っていると更新されなくなるので部分木ごと末尾に移す
+void TransformHierarchy::setStatic(uint32_t index, bool value)
+{
+    if (static_[index] == (uint8_t)value) return;
+    static_[index] = value ? 1 : 0;
+
+    if (!value && index < orderedCount_ && staticSubtrees_[index])
+    {
+        moveSubtreeToEnd(index, parents_[index]);
+    }
+}
+
+
+// 全ての配列を１つ伸ばして、その位置を返す
+uint32_t TransformHierarchy::appendSlot()
+{
+    const uint32_t index = (uint32_t)owners_.size();
+    const size_t count = owners_.size() + 1;
+    owners_.resize(count);
+    parents_.resize(count);
+    localPositions_.resize(count);
+    localRotations_.resize(count);
+    localScales_.resize(count);
+    localMatrices_.resize(count);
+    worldMatrices_.resize(count);
+    worldRotations_.resize(count);
+    lossyScales_.resize(count);
+    inverseWorldMatrices_.resize(count);
+    inverseValid_.resize(count);
+    dirty_.resize(count);
+    static_.resize(count);
+    versions_.resize(count);
+    parentVersions_.resize(count);
+    subtreeSizes_.resize(count);
+    ids_.resize(count, InvalidIndex);
+    return index;
+}
+
+
+// index の部分木を先行順で末尾に移し、根の親を parentIndex にする
+// 移した後も親が子より前に並び、元の位置は穴として残る。計算済みの値と世代番号はそのまま移す
+void TransformHierarchy::moveSubtreeToEnd(uint32_t index, uint32_t parentIndex)
+{
+    stack_.clear();
+    stack_.push_back(index);
+    while (!stack_.empty())
+    {
+        const uint32_t from = stack_.back();
+        stack_.pop_back();
+        const uint32_t to = appendSlot();
+
+        Transform* t = owners_[from];
+        owners_[to] = t;
+        localPositions_[to] = localPositions_[from];
+        localRotations_[to] = localRotations_[from];
+        localScales_[to] = localScales_[from];
+        localMatrices_[to] = localMatrices_[from];
+        worldMatrices_[to] = worldMatrices_[from];
+        worldRotations_[to] = worldRotations_[from];
+        lossyScales_[to] = lossyScales_[from];
+        inverseWorldMatrices_[to] = inverseWorldMatrices_[from];
+        inverseValid_[to] = inverseValid_[from];
+        dirty_[to] = dirty_[from];
+        static_[to] = static_[from];
+        versions_[to] = versions_[from];
+        parentVersions_[to] = parentVersions_[from];
+        subtreeSizes_[to] = 1;
+        ids_[to] = ids_[from];
+        idToIndex_[ids_[to]] = to;
+
+        // 子孫の親は先に移しているので、Transform の持つインデックスが移動先を指している
+        if (from == index)
+        {
+            parents_[to] = parentIndex;
+            dirty_[to] = 1;
+        }
+        else
+        {
+            parents_[to] = t->parent->index_;
+        }
+        t->index_ = to;
+
+        owners_[from] = nullptr;
+        parents_[from] = InvalidIndex;
+        ids_[from] = InvalidIndex;
+        dirty_[from] = 0;
+        static_[from] = 0;
+        ++holeCount_;
+
+        // 取り出したときに元の子の順になるよう逆順に積む
+        const auto& children = t->children;
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+        {
+            if (*it) stack_.push_back((*it)->transform->index_);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 親→子の順（深さ優先の先行順）に配列を並べ替える
+// 部分木は連続した区間になる
+// -----------------------------------------------------------------------------
+void TransformHierarchy::rebuildOrder()
+{
+    const uint32_t count = (uint32_t)owners_.size();
+
+    // 新しい並び順での旧インデックス
+    std::vector<uint32_t> order;
+    order.reserve(size());
+
+    stack_.clear();
+    for (uint32_t root = 0; root < count; ++root)
+    {
+        if (owners_[root] == nullptr || parents_[root] != InvalidIndex) continue;
+
+        stack_.push_back(root);
+        while (!stack_.empty())
+        {
+            const uint32_t i = stack_.back();
+            stack_.pop_back();
+            order.push_back(i);
+
+            // 取り出したときに元の子の順になるよう逆順に積む
+            const auto& children = owners_[i]->children;
+            for (auto it = children.rbegin(); it != children.rend(); ++it)
+            {
+                if (*it) stack_.push_back((*it)->transform->index_);
+            }
+        }
+    }
+
+    std::vector<uint32_t> newIndex(count, InvalidIndex);
+    for (uint32_t n = 0; n < (uint32_t)order.size(); ++n)
+    {
+        newIndex[order[n]] = n;
+    }
+
+    auto permute = [&order](auto& v)
+        {
+            std::remove_reference_t<decltype(v)> sorted;
+            sorted.reserve(order.size());
+            for (uint32_t old : order) sorted.push_back(v[old]);
+            v.swap(sorted);
+        };
+    permute(owners_);
+    permute(parents_);
+    permute(localPositions_);
+    permute(localRotations_);
+    permute(localScales_);
+    permute(localMatrices_);
+    permute(worldMatrices_);
+    permute(worldRotations_);
+    permute(lossyScales_);
+    permute(inverseWorldMatrices_);
+    permute(inverseValid_);
+    permute(dirty_);
+    permute(static_);
+    permute(versions_);
+    permute(parentVersions_);
+    permute(ids_);
+    subtreeSizes_.assign(order.size(), 1);
+
+    const uint32_t newCount = (uint32_t)order.size();
+    for (uint32_t n = 0; n < newCount; ++n)
+    {
+        if (parents_[n] != InvalidIndex) parents_[n] = newIndex[parents_[n]];
+        owners_[n]->index_ = n;
+        idToIndex_[ids_[n]] = n;
+    }
+
+    // 子は親より後ろにあるので、後ろから足し込めば部分木のサイズになる
+    // 静的でない子孫が1つでもあれば、その部分木は静的ではない
+    staticSubtrees_.assign(static_.begin(), static_.end());
+    for (uint32_t n = newCount; n-- > 0;)
+    {
+        const uint32_t p = parents_[n];
+        if (p == InvalidIndex) continue;
+        subtreeSizes_[p] += subtreeSizes_[n];
+        if (!staticSubtrees_[n]) staticSubtrees_[p] = 0;
+    }
+
+    orderedCount_ = newCount;
+    holeCount_ = 0;
+    orderDirty_ = false;
+    buildRanges();
+}
+
+
+// 並列に更新できる区間に分割する
+void TransformHierarchy::buildRanges()
+{
+    serialIndices_.clear();
+    parallelRanges_.clear();
+    staticRanges_.clear();
+
+    const uint32_t count = orderedCount_;
+    uint32_t i = 0;
+    while (i < count)
+    {
+        const uint32_t n = subtreeSizes_[i];
+        if (staticSubtrees_[i])
+        {
+            // 静的な部分木は毎フレームの区間に入れない
+            if (!staticRanges_.empty() && staticRanges_.back().end == i)
+            {
+                staticRanges_.back().end = i + n;
+            }
+            else
+            {
+                staticRanges_.push_back({ i, i + n });
+            }
+            i += n;
+            continue;
+        }
+
+        if (n > parallelGrain)
+        {
+            // 大きな部分木の根だけを逐次処理に回し、その子から分割を続ける
+            serialIndices_.push_back(i);
+            ++i;
+            continue;
+        }
+
+        // 隣接する小さな部分木は1つの区間にまとめる
+        if (!parallelRanges_.empty() && parallelRanges_.back().end == i
+            && parallelRanges_.back().end - parallelRanges_.back().begin + n <= parallelGrain)
+        {
+            parallelRanges_.back().end = i + n;
+        }
+        else
+        {
+            parallelRanges_.push_back({ i, i + n });
+        }
+        i += n;
+    }
+}
+
+}
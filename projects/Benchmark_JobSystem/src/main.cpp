@@ -0,0 +1,315 @@
+﻿// JobSystem と、その上で並列に動く処理の動作確認とマイクロベンチマーク
+// コンソールに結果を表示し、動作確認に失敗したときは 1 を返す
+//
+
+#include <UniDx.h>
+#include <UniDx/JobSystem.h>
+
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <limits>
+
+using namespace UniDx;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+int failures = 0;
+
+void check(bool ok, const char* name)
+{
+    std::printf("  [%s] %s\n", ok ? " OK " : "FAIL", name);
+    if (!ok) ++failures;
+}
+
+
+// repeat 回実行して最短の時間（ミリ秒）を返す
+double measure(int repeat, const std::function<void()>& func)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        const auto start = Clock::now();
+        func();
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+
+// 要素ごとの重めの計算
+float work(float x)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        x = std::sqrt(x * x + 1.0f) * 0.5f;
+    }
+    return x;
+}
+
+
+// -----------------------------------------------------------------------------
+// 動作確認
+// -----------------------------------------------------------------------------
+
+// parallelFor が全ての要素をちょうど１回ずつ処理するか
+void testParallelForCoverage()
+{
+    const size_t counts[] = { 0, 1, 7, 1000, 100003 };
+    const size_t grains[] = { 0, 1, 16, 1000, 1 << 20 };
+
+    bool ok = true;
+    for (size_t count : counts)
+    {
+        for (size_t grain : grains)
+        {
+            std::vector<std::atomic<int>> visited(count);
+            JobSystem::parallelFor(count, grain,
+                [&visited](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i) visited[i].fetch_add(1, std::memory_order_relaxed);
+                });
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (visited[i].load() != 1) ok = false;
+            }
+        }
+    }
+    check(ok, "parallelFor visits every index exactly once");
+}
+
+
+// parallelFor の中で parallelFor を呼んでも（ジョブの中で wait しても）終わるか
+void testNestedParallelFor()
+{
+    const size_t outer = 64;
+    const size_t inner = 4096;
+    std::atomic<size_t> total = 0;
+
+    JobSystem::parallelFor(outer, 1,
+        [&total](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                std::atomic<size_t> sum = 0;
+                JobSystem::parallelFor(inner, 64,
+                    [&sum](size_t b, size_t e) { sum.fetch_add(e - b, std::memory_order_relaxed); });
+                total.fetch_add(sum.load(), std::memory_order_relaxed);
+            }
+        });
+
+    check(total.load() == outer * inner, "nested parallelFor completes");
+}
+
+
+// ジョブの中でジョブを登録して待つ再帰（ワーカー数より深い待ち）
+size_t countTree(JobSystem& js, int depth)
+{
+    if (depth == 0) return 1;
+
+    JobCounter counter;
+    size_t left = 0;
+    size_t right = 0;
+    js.schedule([&js, &left, depth]() { left = countTree(js, depth - 1); }, &counter);
+    js.schedule([&js, &right, depth]() { right = countTree(js, depth - 1); }, &counter);
+    js.wait(counter);
+    return left + right + 1;
+}
+
+void testNestedWait()
+{
+    JobSystem& js = *JobSystem::getInstance();
+    const int depth = 12;
+    const size_t nodes = countTree(js, depth);
+    check(nodes == (size_t(1) << (depth + 1)) - 1, "recursive schedule + wait inside jobs completes");
+}
+
+
+// カウンタは全てのジョブが終わってから 0 になるか
+void testCounter()
+{
+    JobSystem& js = *JobSystem::getInstance();
+    const int jobs = 10000;
+    std::atomic<int> done = 0;
+    JobCounter counter;
+    for (int i = 0; i < jobs; ++i)
+    {
+        js.schedule([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, &counter);
+    }
+    js.wait(counter);
+    check(counter.isDone() && done.load() == jobs, "all jobs are done when wait() returns");
+}
+
+
+// 複数の物理ワールドのシーン
+// 全てのワールドの床と球が、剛体でない同じ親の下にある
+struct PhysicsScene
+{
+    std::vector<std::unique_ptr<PhysicsWorld>> worlds; // root より後に破棄する
+    std::unique_ptr<GameObject> root;
+    std::vector<Transform*> balls;
+};
+
+void awakeAll(GameObject* object)
+{
+    for (auto& c : object->GetComponents()) c->checkAwake();
+    for (auto& child : object->transform->getChildGameObjects()) awakeAll(&*child);
+}
+
+std::unique_ptr<PhysicsScene> makePhysicsScene(size_t worldCount, size_t ballsPerWorld)
+{
+    auto scene = std::make_unique<PhysicsScene>();
+    scene->root = std::make_unique<GameObject>(u8"Root");
+
+    for (size_t w = 0; w < worldCount; ++w)
+    {
+        scene->worlds.push_back(std::make_unique<PhysicsWorld>());
+        PhysicsWorld* world = scene->worlds.back().get();
+        const float x = float(w) * 100.0f;
+
+        // 床
+        auto floor = std::make_unique<GameObject>(u8"Floor", MakeComponent<Rigidbody>(), MakeComponent<AABBCollider>());
+        Rigidbody* floorBody = floor->GetComponent<Rigidbody>(true);
+        floorBody->gravityScale = 0;
+        floorBody->mass = std::numeric_limits<float>::infinity();
+        floorBody->setPhysicsWorld(world);
+        floor->transform->localScale = Vector3(60, 1, 60);
+        floor->transform->localPosition = Vector3(x, -0.5f, 0);
+        floor->isStatic = true;
+        Transform::SetParent(std::move(floor), scene->root->transform);
+
+        // 球は互いに当たらない間隔で並べ、床にだけ当たるようにする
+        for (size_t b = 0; b < ballsPerWorld; ++b)
+        {
+            auto ball = std::make_unique<GameObject>(u8"Ball", MakeComponent<Rigidbody>(), MakeComponent<SphereCollider>());
+            ball->GetComponent<Rigidbody>(true)->setPhysicsWorld(world);
+            ball->transform->localPosition = Vector3(x + float(b % 8) * 3.0f - 12.0f, 2.0f + float(b) * 0.25f, float(b / 8) * 3.0f - 12.0f);
+            scene->balls.push_back(ball->transform);
+            Transform::SetParent(std::move(ball), scene->root->transform);
+        }
+    }
+
+    awakeAll(scene->root.get());
+    return scene;
+}
+
+// SimulateParallel() が、ワールドごとに順に計算したときと同じ結果になるか
+void testPhysicsWorldsParallel()
+{
+    const size_t worldCount = 4;
+    const size_t ballsPerWorld = 32;
+    const int steps = 120;
+
+    auto serial = makePhysicsScene(worldCount, ballsPerWorld);
+    auto parallel = makePhysicsScene(worldCount, ballsPerWorld);
+
+    std::vector<PhysicsWorld*> worlds;
+    for (auto& w : parallel->worlds) worlds.push_back(w.get());
+
+    for (int i = 0; i < steps; ++i)
+    {
+        TransformHierarchy::getInstance()->update();
+        for (auto& w : serial->worlds) w->simulatePositionCorrection(Time::fixedDeltaTime);
+
+        PhysicsWorld::SimulateParallel(worlds, Time::fixedDeltaTime);
+    }
+
+    bool same = true;
+    bool above = true;
+    for (size_t i = 0; i < serial->balls.size(); ++i)
+    {
+        const Vector3 a = serial->balls[i]->position;
+        const Vector3 b = parallel->balls[i]->position;
+        if ((a - b).magnitude() > 1e-4f) same = false;
+        if (b.y < 0.0f) above = false;
+    }
+    check(same, "PhysicsWorld::SimulateParallel matches stepping each world in turn");
+    check(above, "balls in parallel worlds under a shared parent stay above their floors");
+}
+
+
+// -----------------------------------------------------------------------------
+// ベンチマーク
+// -----------------------------------------------------------------------------
+
+// 逐次実行と parallelFor の比較（粒度ごと）
+void benchParallelFor()
+{
+    const size_t count = 1 << 20;
+    std::vector<float> data(count);
+    std::vector<float> result(count);
+    for (size_t i = 0; i < count; ++i) data[i] = float(i % 1000);
+
+    const double serial = measure(5, [&]()
+        {
+            for (size_t i = 0; i < count; ++i) result[i] = work(data[i]);
+        });
+    std::printf("  serial                 %8.3f ms\n", serial);
+
+    const size_t grains[] = { 64, 256, 1024, 4096, 16384, 65536 };
+    for (size_t grain : grains)
+    {
+        const double ms = measure(5, [&]()
+            {
+                JobSystem::parallelFor(count, grain,
+                    [&](size_t begin, size_t end)
+                    {
+                        for (size_t i = begin; i < end; ++i) result[i] = work(data[i]);
+                    });
+            });
+        std::printf("  parallelFor grain %6zu %8.3f ms  x%.2f\n", grain, ms, serial / ms);
+    }
+}
+
+
+// 空のジョブ１つあたりの登録から完了までのコスト
+void benchScheduleOverhead()
+{
+    JobSystem& js = *JobSystem::getInstance();
+    const int jobs = 100000;
+    const double ms = measure(5, [&]()
+        {
+            JobCounter counter;
+            for (int i = 0; i < jobs; ++i) js.schedule([]() {}, &counter);
+            js.wait(counter);
+        });
+    std::printf("  schedule + wait        %8.1f ns/job\n", ms * 1e6 / jobs);
+}
+
+}
+
+
+int main()
+{
+    JobSystem::create();
+    TransformHierarchy::create();
+    Physics::create();
+    std::printf("JobSystem workers: %zu\n\n", JobSystem::getInstance()->workerCount());
+
+    std::printf("Tests\n");
+    testParallelForCoverage();
+    testNestedParallelFor();
+    testNestedWait();
+    testCounter();
+    testPhysicsWorldsParallel();
+
+    std::printf("\nBenchmarks\n");
+    benchParallelFor();
+    benchScheduleOverhead();
+
+    Physics::destroy();
+    TransformHierarchy::destroy();
+    JobSystem::destroy();
+
+    std::printf("\n%s\n", failures == 0 ? "All tests passed." : "Some tests FAILED.");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+﻿// Transform のプロパティのマイクロベンチマーク
+// std::function による Property と、UNIDX_PROPERTY によるプロパティで
+// 同じTransformを読み書きする時間と、Transform の大きさを比較する
+//
+
+#include <UniDx.h>
+
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <functional>
+
+using namespace UniDx;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// 変更前と同じく、std::function のプロパティを持たせたTransform
+// 変更前の Object, Component, Transform が持っていたものを全て持ち、
+// 各プロパティは基底の Transform の同じアクセサを呼ぶ
+class FunctionPropertyTransform : public Transform
+{
+public:
+    ReadOnlyProperty<StringId> name;
+    Property<bool> enabled;
+    ReadOnlyProperty<Transform*> transform;
+
+    Property<Vector3> localPosition;
+    Property<Quaternion> localRotation;
+    Property<Vector3> localScale;
+    Property<Vector3> position;
+    Property<Quaternion> rotation;
+    Property<Vector3> forward;
+    Property<Vector3> up;
+    Property<Vector3> right;
+    ReadOnlyProperty<Vector3> lossyScale;
+
+    FunctionPropertyTransform() :
+        name([this]() { return base().name.get(); }),
+        enabled([this]() { return base().enabled.get(); }, [this](const bool& v) { base().enabled = v; }),
+        transform([this]() { return base().transform.get(); }),
+        localPosition([this]() { return base().localPosition.get(); }, [this](const Vector3& v) { base().localPosition = v; }),
+        localRotation([this]() { return base().localRotation.get(); }, [this](const Quaternion& q) { base().localRotation = q; }),
+        localScale([this]() { return base().localScale.get(); }, [this](const Vector3& v) { base().localScale = v; }),
+        position([this]() { return base().position.get(); }, [this](const Vector3& v) { base().position = v; }),
+        rotation([this]() { return base().rotation.get(); }, [this](const Quaternion& q) { base().rotation = q; }),
+        forward([this]() { return base().forward.get(); }, [this](const Vector3& v) { base().forward = v; }),
+        up([this]() { return base().up.get(); }, [this](const Vector3& v) { base().up = v; }),
+        right([this]() { return base().right.get(); }, [this](const Vector3& v) { base().right = v; }),
+        lossyScale([this]() { return base().lossyScale.get(); })
+    {
+    }
+
+private:
+    Transform& base() { return *this; }
+};
+
+
+// repeat 回実行して最短の時間（ミリ秒）を返す
+double measure(int repeat, const std::function<void()>& func)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        const auto start = Clock::now();
+        func();
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+
+// 最適化で読み出しが消されないように結果を書き出す先
+volatile float sink = 0.0f;
+
+const int Repeat = 10;
+const size_t Count = 100000;
+
+void report(const char* name, double functionMs, double memberMs)
+{
+    std::printf("  %-20s std::function %7.2f ns  UNIDX_PROPERTY %7.2f ns  x%.2f\n",
+        name, functionMs * 1e6 / Count, memberMs * 1e6 / Count, functionMs / memberMs);
+}
+
+
+// 同じTransformの配列を、派生クラスの std::function のプロパティと基底の UNIDX_PROPERTY で読み書きする
+void benchPosition(std::vector<std::unique_ptr<FunctionPropertyTransform>>& transforms)
+{
+    TransformHierarchy::getInstance()->update();
+
+    const double getFunction = measure(Repeat, [&]()
+        {
+            float sum = 0.0f;
+            for (auto& t : transforms) sum += t->position.get().x;
+            sink = sum;
+        });
+    const double getMember = measure(Repeat, [&]()
+        {
+            float sum = 0.0f;
+            for (auto& t : transforms) sum += static_cast<Transform&>(*t).position.get().x;
+            sink = sum;
+        });
+    report("position get", getFunction, getMember);
+
+    const double setFunction = measure(Repeat, [&]()
+        {
+            for (size_t i = 0; i < transforms.size(); ++i) transforms[i]->position = Vector3(float(i), 1.0f, 2.0f);
+        });
+    const double setMember = measure(Repeat, [&]()
+        {
+            for (size_t i = 0; i < transforms.size(); ++i) static_cast<Transform&>(*transforms[i]).position = Vector3(float(i), 1.0f, 2.0f);
+        });
+    report("position set", setFunction, setMember);
+}
+
+
+void benchRotation(std::vector<std::unique_ptr<FunctionPropertyTransform>>& transforms)
+{
+    TransformHierarchy::getInstance()->update();
+
+    const double getFunction = measure(Repeat, [&]()
+        {
+            float sum = 0.0f;
+            for (auto& t : transforms) sum += t->rotation.get().w;
+            sink = sum;
+        });
+    const double getMember = measure(Repeat, [&]()
+        {
+            float sum = 0.0f;
+            for (auto& t : transforms) sum += static_cast<Transform&>(*t).rotation.get().w;
+            sink = sum;
+        });
+    report("rotation get", getFunction, getMember);
+
+    const Quaternion q = Quaternion::Euler(0.0f, 30.0f, 0.0f);
+    const double setFunction = measure(Repeat, [&]()
+        {
+            for (auto& t : transforms) t->rotation = q;
+        });
+    const double setMember = measure(Repeat, [&]()
+        {
+            for (auto& t : transforms) static_cast<Transform&>(*t).rotation = q;
+        });
+    report("rotation set", setFunction, setMember);
+}
+
+}
+
+
+int main()
+{
+    JobSystem::create();
+    TransformHierarchy::create();
+
+    std::printf("sizeof(Transform)\n");
+    std::printf("  std::function properties  %5zu bytes\n", sizeof(FunctionPropertyTransform));
+    std::printf("  UNIDX_PROPERTY            %5zu bytes\n", sizeof(Transform));
+    std::printf("  Property<Vector3>         %5zu bytes\n", sizeof(Property<Vector3>));
+
+    {
+        std::vector<std::unique_ptr<FunctionPropertyTransform>> transforms;
+        transforms.reserve(Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            transforms.push_back(std::make_unique<FunctionPropertyTransform>());
+        }
+
+        std::printf("\nAccess time per Transform (%zu Transforms)\n", Count);
+        benchPosition(transforms);
+        benchRotation(transforms);
+    }
+
+    TransformHierarchy::destroy();
+    JobSystem::destroy();
+    return 0;
+}
@@ -0,0 +1,267 @@
+﻿// D3Dのデバイスを作らずにシーンを抽出し、FramePacket の中身を確かめる
+// コンソールに結果を表示し、確認に失敗したときは 1 を返す
+//
+
+#include <UniDx.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/PlayerLoop.h>
+#include <UniDx/LightManager.h>
+#include <UniDx/Renderer.h>
+#include <UniDx/Material.h>
+#include <UniDx/FramePacket.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <memory>
+
+using namespace UniDx;
+
+namespace
+{
+
+int failures = 0;
+
+void check(bool ok, const char* name)
+{
+    std::printf("  [%s] %s\n", ok ? " OK " : "FAIL", name);
+    if (!ok) ++failures;
+}
+
+
+bool nearlyEqual(const Vector3& a, const Vector3& b)
+{
+    return (a - b).magnitude() < 1e-4f;
+}
+
+
+// -----------------------------------------------------------------------------
+// シーン
+// -----------------------------------------------------------------------------
+
+struct ExtractScene
+{
+    std::unique_ptr<GameObject> root;
+    Camera* camera = nullptr;
+    Light* light = nullptr;
+    Transform* parent = nullptr;                // child の親（Renderer を持たない）
+    std::vector<MeshRenderer*> opaques;
+    std::vector<MeshRenderer*> transparents;
+    MeshRenderer* child = nullptr;              // parent の子の不透明な Renderer
+};
+
+void awakeAll(GameObject* object)
+{
+    for (auto& c : object->GetComponents()) c->checkAwake();
+    for (auto& child : object->transform->getChildGameObjects()) awakeAll(&*child);
+}
+
+MeshRenderer* addRenderer(Transform* parent, const std::shared_ptr<Material>& material, Vector3 position)
+{
+    auto object = std::make_unique<GameObject>(u8"Renderer", MakeComponent<MeshRenderer>());
+    MeshRenderer* renderer = object->GetComponent<MeshRenderer>(true);
+    renderer->AddMaterial(material);
+    object->transform->localPosition = position;
+    Transform::SetParent(std::move(object), parent);
+    return renderer;
+}
+
+std::unique_ptr<ExtractScene> makeScene()
+{
+    auto scene = std::make_unique<ExtractScene>();
+    scene->root = std::make_unique<GameObject>(u8"Root");
+
+    auto camera = std::make_unique<GameObject>(u8"Camera", MakeComponent<Camera>());
+    camera->transform->localPosition = Vector3(0, 3, -10);
+    camera->transform->localRotation = Quaternion::Euler(10, 0, 0);
+    scene->camera = camera->GetComponent<Camera>(true);
+    Transform::SetParent(std::move(camera), scene->root->transform);
+
+    auto light = std::make_unique<GameObject>(u8"Light", MakeComponent<Light>());
+    light->transform->localRotation = Quaternion::Euler(50, -30, 0);
+    scene->light = light->GetComponent<Light>(true);
+    scene->light->color = Color(1.0f, 0.5f, 0.25f, 1.0f);
+    scene->light->intensity = 2.0f;
+    Transform::SetParent(std::move(light), scene->root->transform);
+
+    auto opaque = std::make_shared<Material>();
+    auto transparent = std::make_shared<Material>();
+    transparent->renderingMode = RenderingMode_Transparent;
+
+    // 不透明と半透明を交互に並べる
+    for (int i = 0; i < 4; ++i)
+    {
+        const Vector3 position(float(i) * 2.0f - 3.0f, 0, 0);
+        if (i % 2 == 0) scene->transparents.push_back(addRenderer(scene->root->transform, transparent, position));
+        else scene->opaques.push_back(addRenderer(scene->root->transform, opaque, position));
+    }
+
+    auto parent = std::make_unique<GameObject>(u8"Parent");
+    parent->transform->localPosition = Vector3(0, 0, 5);
+    scene->parent = parent->transform;
+    Transform::SetParent(std::move(parent), scene->root->transform);
+    scene->child = addRenderer(scene->parent, opaque, Vector3(1, 2, 0));
+    scene->opaques.push_back(scene->child);
+
+    awakeAll(scene->root.get());
+    return scene;
+}
+
+void extract(FramePacket& packet)
+{
+    TransformHierarchy::getInstance()->update();
+    packet.clear();
+    PlayerLoop::getInstance()->extract(packet);
+}
+
+
+// パケット内のオブジェクトごとの行列の転送を、転送先の Renderer に振り分ける
+std::vector<const Renderer*> perObjectUploads(const FramePacket& packet)
+{
+    std::vector<const Renderer*> result;
+    for (auto& u : packet.uploads)
+    {
+        if (u.size != sizeof(ConstantBufferPerObject)) continue;
+
+        ConstantBufferPerObject cb;
+        std::memcpy(&cb, packet.uploadData.data() + u.offset, sizeof(cb));
+
+        const Renderer* owner = nullptr;
+        for (auto& draw : packet.draws)
+        {
+            if (draw.world == cb.world) owner = draw.renderer;
+        }
+        result.push_back(owner);
+    }
+    return result;
+}
+
+
+// -----------------------------------------------------------------------------
+// 動作確認
+// -----------------------------------------------------------------------------
+
+// カメラとライトの定数
+void testFrameConstants(const FramePacket& packet, const ExtractScene& scene)
+{
+    const ConstantBufferPerCamera& cb = packet.camera;
+    check(packet.hasCamera, "the main camera is extracted");
+    check(cb.view == scene.camera->GetViewMatrix(), "camera view matrix matches Camera::GetViewMatrix()");
+    check(nearlyEqual(cb.cameraPosW, scene.camera->transform->position), "camera position matches its transform");
+    check(nearlyEqual(cb.cameraForwardW, scene.camera->transform->forward), "camera forward matches its transform");
+    check(cb.cameraNear == scene.camera->nearClip && cb.cameraFar == scene.camera->farClip, "camera clip planes are copied");
+
+    const ConstantBufferLightPerFrame& lights = packet.lights;
+    check(lights.directionalColor == Color(1.0f, 0.5f, 0.25f, 2.0f), "directional light color carries its intensity in alpha");
+    check(nearlyEqual(lights.directionW, scene.light->transform->forward), "directional light direction matches its transform");
+    check(lights.ambientColor == LightManager::getInstance()->ambientColor, "ambient color is copied");
+}
+
+// Rendererごとのワールド行列
+void testWorldMatrices(const FramePacket& packet, const ExtractScene& scene)
+{
+    const size_t rendererCount = scene.opaques.size() + scene.transparents.size();
+    check(packet.draws.size() == rendererCount, "every enabled renderer produces one draw");
+
+    bool matches = true;
+    for (auto& draw : packet.draws)
+    {
+        if (draw.world != draw.renderer->transform->localToWorldMatrix()) matches = false;
+    }
+    check(matches, "each draw carries its renderer's world matrix");
+
+    const FrameDraw* childDraw = nullptr;
+    for (auto& draw : packet.draws)
+    {
+        if (draw.renderer == scene.child) childDraw = &draw;
+    }
+    check(childDraw != nullptr
+        && nearlyEqual(Vector3(childDraw->world.m30, childDraw->world.m31, childDraw->world.m32), Vector3(1, 2, 5)),
+        "a child renderer's world matrix includes its parent's position");
+}
+
+// 不透明、半透明のパスに入る描画とその順番
+void testPassOrder(const FramePacket& packet, const ExtractScene& scene)
+{
+    std::vector<const Renderer*> opaquePass;
+    std::vector<const Renderer*> transparentPass;
+    packet.forEachDraw(RenderingMode_Opaque, [&](const FrameDraw& draw) { opaquePass.push_back(draw.renderer); });
+    packet.forEachDraw(RenderingMode_Transparent, [&](const FrameDraw& draw) { transparentPass.push_back(draw.renderer); });
+
+    // どちらのパスも抽出した順
+    std::vector<const Renderer*> expectedOpaque;
+    std::vector<const Renderer*> expectedTransparent;
+    for (auto& draw : packet.draws)
+    {
+        bool transparent = false;
+        for (auto* r : scene.transparents)
+        {
+            if (draw.renderer == r) transparent = true;
+        }
+        (transparent ? expectedTransparent : expectedOpaque).push_back(draw.renderer);
+    }
+
+    check(opaquePass.size() == scene.opaques.size() && opaquePass == expectedOpaque,
+        "the opaque pass draws only opaque renderers, in extraction order");
+    check(transparentPass.size() == scene.transparents.size() && transparentPass == expectedTransparent,
+        "the transparent pass draws only transparent renderers, in extraction order");
+}
+
+// 姿勢が変わったRendererだけが定数バッファを転送する
+void testUploads(FramePacket& packet, ExtractScene& scene)
+{
+    const size_t rendererCount = scene.opaques.size() + scene.transparents.size();
+
+    extract(packet);
+    check(perObjectUploads(packet).empty(), "nothing moved: no per-object uploads");
+
+    // 1つとカメラを動かす
+    MeshRenderer* moved = scene.opaques.front();
+    moved->transform->localPosition = Vector3(0, 1, 0);
+    scene.camera->transform->localPosition = Vector3(0, 4, -12);
+    extract(packet);
+    auto uploads = perObjectUploads(packet);
+    check(uploads.size() == 1 && uploads.front() == moved, "moving one renderer uploads only its world matrix");
+    check(packet.camera.view == scene.camera->GetViewMatrix(), "moving the camera updates the view matrix without renderer uploads");
+
+    // 親を動かすと子の行列だけが転送される
+    scene.parent->localPosition = Vector3(0, 0, 8);
+    extract(packet);
+    uploads = perObjectUploads(packet);
+    check(uploads.size() == 1 && uploads.front() == scene.child, "moving a parent uploads only its descendant renderer");
+
+    check(packet.draws.size() == rendererCount, "unchanged renderers are still drawn");
+}
+
+} // namespace
+
+
+int main()
+{
+    JobSystem::create();
+    TransformHierarchy::create();
+    LightManager::create();
+    PlayerLoop::create();
+
+    std::printf("Tests\n");
+    {
+        auto scene = makeScene();
+        FramePacket packet;
+        extract(packet);
+
+        const size_t rendererCount = scene->opaques.size() + scene->transparents.size();
+        check(perObjectUploads(packet).size() == rendererCount, "the first extraction uploads every renderer's world matrix");
+        testFrameConstants(packet, *scene);
+        testWorldMatrices(packet, *scene);
+        testPassOrder(packet, *scene);
+        testUploads(packet, *scene);
+    }
+
+    PlayerLoop::destroy();
+    LightManager::destroy();
+    TransformHierarchy::destroy();
+    JobSystem::destroy();
+
+    std::printf("\n%s\n", failures == 0 ? "All tests passed." : "Some tests FAILED.");
+    return failures == 0 ? 0 : 1;
+}
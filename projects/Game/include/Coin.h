@@ -2,13 +2,13 @@
 
 #include <UniDx.h>
 
-class Coin : public UniDx::Behaviour
+class CoinSpinner : public UniDx::Behaviour
 {
+public:
+	UniDx::TransformAccessArray coins;
+	float rotateSpeed = 240.0f;
+
 protected:
-	virtual void OnEnable() override;
 	virtual void Update() override;
-
-	float yRot;
-	float rotateSpeed = 240.0f;
+	virtual UniDx::ComponentPtr<UniDx::Component> clone(UniDx::CloneMap& map) const override { return UniDx::CloneComponent(*this); }
 };
-
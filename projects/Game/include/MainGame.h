@@ -11,12 +11,15 @@ namespace UniDx
     class TextMesh;
 }
 
+class CoinSpinner;
+
 class MainGame : public UniDx::Singleton<MainGame>
 {
 public:
     virtual ~MainGame();
 
     void AddScore(int n);
+    void RemoveCoin(GameObject* coin);
     void CheckGameClear();
 
     unique_ptr<UniDx::Scene> CreateScene();
@@ -27,6 +30,8 @@ protected:
     UniDx::TextMesh* scoreTextMesh;
     UniDx::TextMesh* gameClearTextMesh;
     std::vector<GameObject*> coinObjects;
+    unique_ptr<UniDx::Prefab> coinPrefab;
+    CoinSpinner* coinSpinner;
     Player* player;
 
     void createMap();
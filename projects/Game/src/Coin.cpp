@@ -2,17 +2,12 @@
 
 using namespace UniDx;
 
-void Coin::OnEnable()
+// SẴRCY܂ɂ܂Ƃ߂ĉ]
+void CoinSpinner::Update()
 {
-	yRot = transform->rotation.get().y;
-}
-
-void Coin::Update()
-{
-	float xRot = transform->rotation.get().x;
-	float zRot = transform->rotation.get().z;
-
-	//]
-	yRot += rotateSpeed * Time::deltaTime;
-	transform->rotation = Quaternion::Euler(xRot, yRot, zRot);
+	const Quaternion delta = Quaternion::AngleAxis(rotateSpeed * Time::deltaTime, Vector3::up);
+	coins.ForEach([delta](size_t, TransformAccess& t)
+		{
+			t.localRotation = delta * t.localRotation;
+		});
 }
\ No newline at end of file
@@ -55,8 +55,24 @@ void MainGame::createMap()
     wallTex->Load(u8"resource/wall.png");
     wallMat->AddTexture(std::move(wallTex));
 
-    // マップ作成
+    // コインのテンプレート（モデルの読み込みは１回だけにして、各コインはこれを複製する）
+    auto coinTemplate = make_unique<GameObject>(u8"Coin",
+        make_unique<GltfModel>(),
+        make_unique<Rigidbody>(),
+        make_unique<SphereCollider>(Vector3(0, -0.1f, 0), 0.4f)
+    );
+    coinTemplate->GetComponent<GltfModel>(true)->Load<VertexPN>(
+        u8"resource/coin.glb",
+        coinMat);
+    coinTemplate->transform->localScale = Vector3(3, 3, 3);
+    coinPrefab = make_unique<Prefab>(move(coinTemplate));
+
+    // マップ作成（マップ自体も動かさない）
     auto map = make_unique<GameObject>();
+    map->isStatic = true;
+
+    // コインの回転は１つのコンポーネントでまとめて行う
+    coinSpinner = map->AddComponent<CoinSpinner>();
 
     // 各ブロック作成
     for (int i = 0; i < MapData::getInstance()->getWidth(); i++)
@@ -67,7 +83,7 @@ void MainGame::createMap()
             {
             case '#':
             {
-                auto rb = make_unique<Rigidbody>();
+                auto rb = MakeComponent<Rigidbody>();
                 rb->gravityScale = 0;
                 rb->mass = numeric_limits<float>::infinity();
 
@@ -75,7 +91,7 @@ void MainGame::createMap()
                 auto wall = make_unique<GameObject>(u8"壁",
                     CubeRenderer::create<VertexPNT>(wallMat),
                     move(rb),
-                    make_unique<AABBCollider>());
+                    MakeComponent<AABBCollider>());
                 wall->transform->localScale = Vector3(2, 2, 2);
                 wall->transform->localPosition = Vector3(
                     i * 2 - float(MapData::getInstance()->getWidth() / 2) * 2,
@@ -83,6 +99,9 @@ void MainGame::createMap()
                     j * -2 + float(MapData::getInstance()->getHeight() / 2) * 2
                 );
 
+                // 壁は動かないので静的にする
+                wall->isStatic = true;
+
                 // 壁の親をマップにする
                 Transform::SetParent(move(wall), map->transform);
             }
@@ -90,29 +109,17 @@ void MainGame::createMap()
 
             case 'C':
             {
-                // コインオブジェクトを作成
-                auto coin = make_unique<GameObject>(u8"Coin",
-                    make_unique<GltfModel>(),
-                    make_unique<Rigidbody>(),
-                    make_unique<SphereCollider>(Vector3(0, -0.1f, 0), 0.4f),
-                    make_unique<Coin>()
-                );
-                auto model = coin->GetComponent<GltfModel>(true);
-                model->Load<VertexPN>(
-                    u8"resource/coin.glb",
-                    coinMat);
-
-                coin->transform->localPosition = Vector3(
-                    i * 2 - float(MapData::getInstance()->getWidth() / 2) * 2,
-                    -0.5f,
-                    j * -2 + float(MapData::getInstance()->getHeight() / 2) * 2
-                );
-                coin->transform->localScale = Vector3(3, 3, 3);
-
-                // コインの親をマップにする
-                Transform::SetParent(move(coin), map->transform);
-
-                coinObjects.push_back(coin.get());
+                // コインオブジェクトをテンプレートから作成し、親をマップにする
+                auto coin = coinPrefab->Instantiate(map->transform,
+                    Vector3(
+                        i * 2 - float(MapData::getInstance()->getWidth() / 2) * 2,
+                        -0.5f,
+                        j * -2 + float(MapData::getInstance()->getHeight() / 2) * 2
+                    ),
+                    Quaternion::identity);
+
+                coinObjects.push_back(coin);
+                coinSpinner->coins.Add(coin->transform);
             }
             break;
 
@@ -123,13 +130,13 @@ void MainGame::createMap()
             // 床
             if (i % 2 == 0 && j % 2 == 0)
             {
-                auto rb = make_unique<Rigidbody>();
+                auto rb = MakeComponent<Rigidbody>();
                 rb->gravityScale = 0;
                 rb->mass = numeric_limits<float>::infinity();
                 auto floor = make_unique<GameObject>(u8"床",
                     CubeRenderer::create<VertexPNT>(floorMat),
                     move(rb),
-                    make_unique<AABBCollider>());
+                    MakeComponent<AABBCollider>());
                 floor->transform->localScale = Vector3(4, 1, 4);
                 floor->transform->localPosition = Vector3(
                     i * 2 - float(MapData::getInstance()->getWidth() / 2) * 2 + 1.0f,
@@ -137,6 +144,8 @@ void MainGame::createMap()
                     j * -2 + float(MapData::getInstance()->getHeight() / 2) * 2 - 1.0f
                 );
 
+                floor->isStatic = true;
+
                 // 壁の親をマップにする
                 Transform::SetParent(move(floor), map->transform);
             }
@@ -264,8 +273,16 @@ void MainGame::AddScore(int n)
     scoreTextMesh->text = u8"スコア " + ToString(score);
 }
 
+// 取ったコインを残りのコインから外す（プールに戻すので nullptr にはならない）
+void MainGame::RemoveCoin(GameObject* coin)
+{
+    coinObjects.erase(remove(coinObjects.begin(), coinObjects.end(), coin), coinObjects.end());
+    coinSpinner->coins.Remove(coin->transform);
+    CheckGameClear();
+}
+
 void MainGame::CheckGameClear()
 {
-    coinObjects.erase(remove_if(coinObjects.begin(), coinObjects.end(), [](GameObject* c) { return c == nullptr; }));
+    coinObjects.erase(remove_if(coinObjects.begin(), coinObjects.end(), [](GameObject* c) { return c == nullptr; }), coinObjects.end());
     if (coinObjects.size() == 0) gameClearTextMesh->text = u8"Game Clear";
 }
@@ -96,8 +96,11 @@ void Player::OnCollisionEnter(const Collision& collision)
 {
     if (collision.collider->name == StringId::intern("Coin"))
     {
+        GameObject* coin = collision.collider->gameObject;
         MainGame::getInstance()->AddScore(1);
-        Destroy(collision.collider->gameObject);
+        // v[ɖ߂ƃnhς̂ŁAɎc̃RCO
+        MainGame::getInstance()->RemoveCoin(coin);
+        Release(coin);
     }
 }
 